@@ -0,0 +1,187 @@
+#pragma once
+
+#include "aba.h"
+
+namespace snmalloc
+{
+  /**
+   * A Treiber stack with the same interface as `MPMCStack`, and an
+   * elimination array in front of it for when the top is contended.
+   *
+   * A push that loses the race for the top offers its item in a slot of the
+   * array for a short while, and a pop that loses the race tries to take an
+   * offered item from a slot.  A matched push and pop complete without
+   * touching the top again, so heavy contention turns into pairs of
+   * operations on different cache lines rather than retries on one.  The
+   * uncontended path is the same single compare and swap as `MPMCStack`.
+   *
+   * Only single items are offered.  Lists pushed with `push(first, last)` and
+   * drained with `pop_all` always go through the top, so `pop_all` returns
+   * everything that has been pushed, except for pushes that are still in
+   * progress, as with `MPMCStack`.
+   *
+   * The slots are empty when zeroed, so this supports `PreZeroed`.
+   */
+  template<class T, Construction c = RequiresInit>
+  class EliminationStack
+  {
+    using ABAT = ABA<T, c>;
+
+  private:
+    static_assert(
+      std::is_same<decltype(T::next), std::atomic<T*>>::value,
+      "T->next must be a std::atomic<T*>");
+
+    /**
+     * The number of elimination slots.  A few slots are enough for a pair to
+     * meet without them contending on a single one.
+     */
+    static constexpr size_t SLOTS = 4;
+
+    /**
+     * How many times a push waits for a pop to take its offered item before
+     * it withdraws it and retries on the top.
+     */
+    static constexpr size_t OFFER_SPINS = 128;
+
+    /**
+     * A slot is empty (`nullptr`), holds an offered item, or has had its
+     * item taken by a pop.  Only the pusher that offered the item empties a
+     * taken slot, so a slot cannot be reused while that pusher is still
+     * waiting on it.  Slots are on their own (64 byte) cache lines.
+     */
+    struct alignas(64) Slot
+    {
+      std::atomic<T*> item{nullptr};
+    };
+
+    ABAT stack;
+    Slot slots[SLOTS];
+
+    static T* taken()
+    {
+      return reinterpret_cast<T*>(uintptr_t(1));
+    }
+
+    Slot& pick_slot()
+    {
+      return slots[Aal::tick() % SLOTS];
+    }
+
+    /**
+     * Offer `item` to a concurrent pop.  Returns true if a pop took it, or
+     * false if it must be pushed on the top after all.
+     */
+    bool offer(T* item)
+    {
+      Slot& slot = pick_slot();
+      T* empty = nullptr;
+      if (!slot.item.compare_exchange_strong(
+            empty, item, std::memory_order_release, std::memory_order_relaxed))
+        return false;
+
+      for (size_t i = 0; i < OFFER_SPINS; i++)
+      {
+        if (slot.item.load(std::memory_order_relaxed) == taken())
+        {
+          slot.item.store(nullptr, std::memory_order_relaxed);
+          return true;
+        }
+        Aal::pause();
+      }
+
+      // Withdraw the offer, unless a pop took it in the meantime.
+      if (slot.item.compare_exchange_strong(
+            item, nullptr, std::memory_order_relaxed))
+        return false;
+
+      slot.item.store(nullptr, std::memory_order_relaxed);
+      return true;
+    }
+
+    /**
+     * Take an item offered by a concurrent push, if there is one.
+     */
+    T* take()
+    {
+      Slot& slot = pick_slot();
+      T* item = slot.item.load(std::memory_order_relaxed);
+      if ((item == nullptr) || (item == taken()))
+        return nullptr;
+
+      if (slot.item.compare_exchange_strong(
+            item,
+            taken(),
+            std::memory_order_acquire,
+            std::memory_order_relaxed))
+        return item;
+
+      return nullptr;
+    }
+
+  public:
+    void push(T* item)
+    {
+      return push(item, item);
+    }
+
+    void push(T* first, T* last)
+    {
+      // Pushes an item on the stack.
+      auto cmp = stack.read();
+
+      while (true)
+      {
+        T* top = ABAT::ptr(cmp);
+        last->next.store(top, std::memory_order_release);
+
+        if (stack.compare_exchange(cmp, first))
+          return;
+
+        if ((first == last) && offer(first))
+          return;
+      }
+    }
+
+    T* pop()
+    {
+      // Returns the next item. If the returned value is decommitted, it is
+      // possible for the read of top->next to segfault.
+      auto cmp = stack.read();
+
+      while (true)
+      {
+        T* top = ABAT::ptr(cmp);
+
+        if (top == nullptr)
+          return nullptr;
+
+        T* next = top->next.load(std::memory_order_acquire);
+
+        if (stack.compare_exchange(cmp, next))
+          return top;
+
+        T* item = take();
+        if (item != nullptr)
+          return item;
+      }
+    }
+
+    T* pop_all()
+    {
+      // Returns all items as a linked list, leaving an empty stack.
+      auto cmp = stack.read();
+      T* top;
+
+      do
+      {
+        top = ABAT::ptr(cmp);
+
+        if (top == nullptr)
+          break;
+      } while (!stack.compare_exchange(cmp, nullptr));
+
+      return top;
+    }
+  };
+} // namespace snmalloc
@@ -47,15 +47,18 @@ namespace snmalloc
       return bk == front;
     }
 
-    void enqueue(T* first, T* last)
+    T* enqueue(T* first, T* last)
     {
       // Pushes a list of messages to the queue. Each message from first to
-      // last should be linked together through their next pointers.
+      // last should be linked together through their next pointers.  Returns
+      // the message that was at the back of the queue before, so that a
+      // sender can tell whether others have pushed since it last did.
       invariant();
       last->next.store(nullptr, std::memory_order_relaxed);
       std::atomic_thread_fence(std::memory_order_release);
       T* prev = back.exchange(last, std::memory_order_relaxed);
       prev->next.store(first, std::memory_order_relaxed);
+      return prev;
     }
 
     std::pair<T*, bool> dequeue()
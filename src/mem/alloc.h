@@ -10,6 +10,7 @@
 #include "../test/histogram.h"
 #include "allocstats.h"
 #include "chunkmap.h"
+#include "heapprofile.h"
 #include "largealloc.h"
 #include "mediumslab.h"
 #include "pooled.h"
@@ -69,7 +70,9 @@ namespace snmalloc
    *
    * The `ChunkMap` parameter provides the adaptor to the pagemap.  This is used
    * to associate metadata with large (16MiB, by default) regions, allowing an
-   * allocator to find the allocator responsible for that region.
+   * allocator to find the allocator responsible for that region.  It also
+   * provides the slab map, which gives the owner and size class of each small
+   * slab.
    *
    * The final template parameter, `IsQueueInline`, defines whether the
    * message queue for this allocator should be stored as a field of the
@@ -100,6 +103,11 @@ namespace snmalloc
      */
     void* bump_ptrs[NUM_SMALL_CLASSES] = {nullptr};
 
+    /**
+     * Sampling state for the heap profiler.
+     */
+    HeapProfiler profiler;
+
   public:
     Stats& stats()
     {
@@ -199,6 +207,28 @@ namespace snmalloc
 #endif
     }
 
+    /**
+     * Allocate `size` bytes aligned to `alignment`, which must be a power of
+     * two.  Unlike allocating `aligned_size(alignment, size)` bytes, this
+     * uses medium slots and large chunks that happen to be aligned, so the
+     * object may be in a smaller size class than that.  It must therefore be
+     * freed without a size, or with the size given by `alloc_size`.
+     */
+    template<ZeroMem zero_mem = NoZero, AllowReserve allow_reserve = YesReserve>
+    SNMALLOC_FAST_PATH ALLOCATOR void*
+    alloc_aligned(size_t alignment, size_t size)
+    {
+      size_t asize = aligned_size(alignment, size);
+#ifndef USE_MALLOC
+      // The position of a small object in its slab fixes its alignment, so
+      // there is nothing better to do than round up the size.
+      if (likely(asize > sizeclass_to_size(NUM_SMALL_CLASSES - 1)))
+        return alloc_aligned_slow<zero_mem, allow_reserve>(
+          alignment, size, asize);
+#endif
+      return alloc<zero_mem, allow_reserve>(asize);
+    }
+
     /*
      * Free memory of a statically known size. Must be called with an
      * external pointer.
@@ -212,6 +242,8 @@ namespace snmalloc
 #else
       constexpr sizeclass_t sizeclass = size_to_sizeclass_const(size);
 
+      HeapProfiler::dealloc(p);
+
       if (sizeclass < NUM_SMALL_CLASSES)
       {
         Superslab* super = Superslab::get(p);
@@ -249,6 +281,8 @@ namespace snmalloc
       UNUSED(size);
       return free(p);
 #else
+      HeapProfiler::dealloc(p);
+
       if (likely((size - 1) <= (sizeclass_to_size(NUM_SMALL_CLASSES - 1) - 1)))
       {
         Superslab* super = Superslab::get(p);
@@ -292,35 +326,48 @@ namespace snmalloc
 #ifdef USE_MALLOC
       return free(p);
 #else
+      HeapProfiler::dealloc(p);
 
-      uint8_t size = chunkmap().get(address_cast(p));
+      // The slab map gives the owner and size class of a small object
+      // without touching the superslab header, which only the owner needs.
+      // Reading a remote entry won't fail, since the other allocator can't
+      // reuse the slab, as we have not yet deallocated this pointer.
+      uintptr_t owner = ChunkMap::get_slab_owner(address_cast(p));
 
-      Superslab* super = Superslab::get(p);
-
-      if (likely(size == CMSuperslab))
+      if (likely(owner != 0))
       {
-        RemoteAllocator* target = super->get_allocator();
-        Slab* slab = Metaslab::get_slab(p);
-        Metaslab& meta = super->get_meta(slab);
-
-        // Reading a remote sizeclass won't fail, since the other allocator
-        // can't reuse the slab, as we have not yet deallocated this
-        // pointer.
-        sizeclass_t sizeclass = meta.sizeclass;
+        RemoteAllocator* target = ChunkMap::slab_owner_allocator(owner);
+        sizeclass_t sizeclass = ChunkMap::slab_owner_sizeclass(owner);
 
-        if (likely(super->get_allocator() == public_state()))
-          small_dealloc(super, p, sizeclass);
+        if (likely(target == public_state()))
+          small_dealloc(Superslab::get(p), p, sizeclass);
         else
           remote_dealloc(target, p, sizeclass);
         return;
       }
-      dealloc_not_small(p, size);
+      dealloc_not_small(p, chunkmap().get(address_cast(p)));
     }
 
     SNMALLOC_SLOW_PATH void dealloc_not_small(void* p, uint8_t size)
     {
       handle_message_queue();
 
+      if (size == CMSuperslab)
+      {
+        // A small object from a slab with no slab map entry, which is one
+        // allocated by an instance that shares only the chunk map.
+        Superslab* super = Superslab::get(p);
+        RemoteAllocator* target = super->get_allocator();
+        Metaslab& meta = super->get_meta(Metaslab::get_slab(p));
+        sizeclass_t sizeclass = meta.sizeclass;
+
+        if (target == public_state())
+          small_dealloc(super, p, sizeclass);
+        else
+          remote_dealloc(target, p, sizeclass);
+        return;
+      }
+
       if (p == nullptr)
         return;
 
@@ -352,8 +399,105 @@ namespace snmalloc
         error("Not deallocating start of an object");
       }
 #  endif
-      large_dealloc(p, 1ULL << size);
+      large_dealloc(p, ChunkMap::get_large_size(address_cast(p), size));
+#endif
+    }
+
+    /**
+     * Allocate `n` objects of a statically known size into `out`.
+     *
+     * Small objects are taken a whole free list at a time, rather than
+     * paying for the fast path on every object.  Returns the number of
+     * objects allocated, which is less than `n` only if memory is exhausted.
+     */
+    template<
+      size_t size,
+      ZeroMem zero_mem = NoZero,
+      AllowReserve allow_reserve = YesReserve>
+    size_t alloc_batch(void** out, size_t n)
+    {
+#ifndef USE_MALLOC
+      constexpr sizeclass_t sizeclass = size_to_sizeclass_const(size);
+
+      if constexpr (sizeclass < NUM_SMALL_CLASSES)
+      {
+        return small_alloc_batch<zero_mem, allow_reserve>(sizeclass, out, n);
+      }
+      else
+#endif
+      {
+        for (size_t i = 0; i < n; i++)
+        {
+          out[i] = alloc<size, zero_mem, allow_reserve>();
+          if (out[i] == nullptr)
+            return i;
+        }
+        return n;
+      }
+    }
+
+    /**
+     * Allocate `n` objects of a dynamically known size into `out`.
+     */
+    template<ZeroMem zero_mem = NoZero, AllowReserve allow_reserve = YesReserve>
+    size_t alloc_batch(size_t size, void** out, size_t n)
+    {
+#ifndef USE_MALLOC
+      if ((size - 1) <= (sizeclass_to_size(NUM_SMALL_CLASSES - 1) - 1))
+      {
+        return small_alloc_batch<zero_mem, allow_reserve>(
+          size_to_sizeclass(size), out, n);
+      }
 #endif
+      for (size_t i = 0; i < n; i++)
+      {
+        out[i] = alloc<zero_mem, allow_reserve>(size);
+        if (out[i] == nullptr)
+          return i;
+      }
+      return n;
+    }
+
+    /**
+     * Free `n` objects of a statically known size.  Must be called with
+     * external pointers.
+     *
+     * Consecutive small objects from the same local slab are returned to the
+     * slab's free list in one step.
+     */
+    template<size_t size>
+    void dealloc_batch(void** ptrs, size_t n)
+    {
+#ifndef USE_MALLOC
+      constexpr sizeclass_t sizeclass = size_to_sizeclass_const(size);
+
+      if constexpr (sizeclass < NUM_SMALL_CLASSES)
+      {
+        small_dealloc_batch(sizeclass, ptrs, n);
+      }
+      else
+#endif
+      {
+        for (size_t i = 0; i < n; i++)
+          dealloc<size>(ptrs[i]);
+      }
+    }
+
+    /**
+     * Free `n` objects of a dynamically known size.  Must be called with
+     * external pointers.
+     */
+    void dealloc_batch(void** ptrs, size_t n, size_t size)
+    {
+#ifndef USE_MALLOC
+      if ((size - 1) <= (sizeclass_to_size(NUM_SMALL_CLASSES - 1) - 1))
+      {
+        small_dealloc_batch(size_to_sizeclass(size), ptrs, n);
+        return;
+      }
+#endif
+      for (size_t i = 0; i < n; i++)
+        dealloc(ptrs[i], size);
     }
 
     template<Boundary location = Start>
@@ -372,7 +516,15 @@ namespace snmalloc
         Metaslab& meta = super->get_meta(slab);
 
         sizeclass_t sc = meta.sizeclass;
-        void* slab_end = pointer_offset(slab, SLAB_SIZE);
+        void* slab_end = pointer_offset(
+          slab,
+          SLAB_SIZE -
+            get_slab_colour(sc, address_cast(slab), Metaslab::is_short(slab)));
+
+        // Space after the last object of a coloured slab belongs to none,
+        // so treat it as the end of the last object.
+        if (p >= slab_end)
+          p = pointer_offset_signed(slab_end, -1);
 
         return external_pointer<location>(p, sc, slab_end);
       }
@@ -409,9 +561,9 @@ namespace snmalloc
       if constexpr (location == Start)
         return ss;
       else if constexpr (location == End)
-        return (ss + (1ULL << size) - 1ULL);
+        return (ss + ChunkMap::get_large_size(ss, size) - 1ULL);
       else
-        return (ss + (1ULL << size));
+        return (ss + ChunkMap::get_large_size(ss, size));
 #endif
     }
 
@@ -449,7 +601,8 @@ namespace snmalloc
         return sizeclass_to_size(slab->get_sizeclass());
       }
 
-      return 1ULL << size;
+      return ChunkMap::get_large_size(
+        address_cast(p), static_cast<uint8_t>(size));
     }
 
     size_t get_id()
@@ -457,6 +610,169 @@ namespace snmalloc
       return id();
     }
 
+    /**
+     * Handle up to `budget` messages from other threads freeing memory owned
+     * by this allocator, and return how many were handled.  This lets a
+     * thread with idle time, such as an event loop, do this work off its
+     * critical path, so that allocation slow paths find less to do.
+     */
+    size_t drain_messages(size_t budget = REMOTE_BATCH)
+    {
+      size_t handled = 0;
+
+      while ((handled < budget) && has_any_messages())
+      {
+        size_t slice = bits::min(budget - handled, REMOTE_BATCH);
+        size_t done = handle_message_queue_inner(slice);
+        handled += done;
+
+        if (done < slice)
+          break;
+      }
+
+      return handled;
+    }
+
+    /**
+     * Send the frees of memory owned by other allocators that are cached
+     * here to their owners, rather than waiting for the cache to fill.
+     */
+    void flush_remote_cache()
+    {
+      if (NeedsInitialisation(this))
+        return;
+
+      if (remote.capacity < remote.cache_size)
+        remote.post(id(), stats());
+    }
+
+    /**
+     * Return the free chunks cached by this allocator to the memory
+     * provider's large stacks.
+     */
+    void flush_large_cache()
+    {
+      if (NeedsInitialisation(this))
+        return;
+
+      large_allocator.flush_cache();
+    }
+
+    /**
+     * The size the remote cache currently adapts to, in bytes.
+     */
+    int64_t get_remote_cache_size()
+    {
+      return remote.cache_size;
+    }
+
+    /**
+     * Try to resize the large allocation `p` to `size` bytes without moving
+     * it.  Large allocations are a whole number of superslabs.  Growing
+     * takes the free chunks that follow `p` from the large stacks, so it
+     * succeeds only if they are all free.  Shrinking returns the tail to the
+     * large stacks.  Returns false, leaving `p` unchanged, if `p` is not a
+     * large allocation, `size` is not a large size, either size is reserved
+     * directly from the platform, or growing would need a chunk in use.
+     */
+    bool resize_large_in_place(void* p, size_t size)
+    {
+#ifdef USE_MALLOC
+      UNUSED(p);
+      UNUSED(size);
+      return false;
+#else
+      if (NeedsInitialisation(this))
+      {
+        void* replacement = InitThreadAllocator();
+        return reinterpret_cast<Allocator*>(replacement)
+          ->resize_large_in_place(p, size);
+      }
+
+      constexpr size_t max_medium = sizeclass_to_size(NUM_SIZECLASSES - 1);
+      size_t old_size = alloc_size(p);
+      if ((old_size <= max_medium) || (size <= max_medium))
+        return false;
+
+      size_t old_class = bits::next_pow2_bits(old_size) - SUPERSLAB_BITS;
+      size_t new_class = bits::next_pow2_bits(size) - SUPERSLAB_BITS;
+      if (new_class >= NUM_LARGE_CLASSES)
+        return false;
+      // A large allocation only commits the bytes requested, so commit up to
+      // the new size before handing it out.
+      auto& mp = large_allocator.memory_provider;
+      size_t new_size = bits::align_up(size, SUPERSLAB_SIZE);
+      if (new_size == old_size)
+      {
+        mp.template notify_using<NoZero>(p, bits::align_up(size, OS_PAGE_SIZE));
+        return true;
+      }
+
+      if (
+        large_allocator.is_direct(old_size) ||
+        large_allocator.is_direct(new_size))
+        return false;
+
+      if (new_size > old_size)
+      {
+        if (!take_large_range(
+              pointer_offset(p, old_size), pointer_offset(p, new_size)))
+          return false;
+
+        mp.template notify_using<NoZero>(p, bits::align_up(size, OS_PAGE_SIZE));
+      }
+
+      // Record the new size before a tail is returned to the large stacks,
+      // as another thread may take it from there and record its own use.
+      chunkmap().clear_large_size(p, old_size);
+      chunkmap().set_large_size(p, size);
+      stats().large_dealloc(old_class);
+      stats().large_alloc(new_class);
+
+      if (new_size < old_size)
+        large_allocator.dealloc_range(
+          pointer_offset(p, new_size), old_size - new_size);
+      return true;
+#endif
+    }
+
+    /**
+     * Copy `size` bytes from the large allocation `src` to the large
+     * allocation `dst`.  Where the platform can move pages, whole pages are
+     * moved rather than copied, leaving the contents of `src` undefined.
+     * Returns false if `src` has lost its pages altogether, in which case it
+     * must be leaked rather than freed.
+     */
+    bool move_large(void* dst, void* src, size_t size)
+    {
+      // `src` may not be committed beyond the size it was allocated with.
+      auto& mp = large_allocator.memory_provider;
+      mp.template notify_using<NoZero>(src, bits::align_up(size, OS_PAGE_SIZE));
+
+      if constexpr (pal_supports<PageRemap, MemoryProvider>)
+      {
+        size_t pages = bits::align_down(size, OS_PAGE_SIZE);
+        if (pages >= SUPERSLAB_SIZE)
+        {
+          memcpy(
+            pointer_offset(dst, pages),
+            pointer_offset(src, pages),
+            size - pages);
+          size_t src_size = alloc_size(src);
+          size_t large_class = large_allocator.is_direct(src_size) ?
+            NUM_LARGE_CLASSES :
+            bits::next_pow2_bits(src_size) - SUPERSLAB_BITS;
+          RemapResult r = mp.remap_large(dst, src, pages, large_class);
+          if (r != RemapFailed)
+            return r != RemapSourceLost;
+          size = pages;
+        }
+      }
+
+      memcpy(dst, src, size);
+      return true;
+    }
+
   private:
     using alloc_id_t = typename Remote::alloc_id_t;
 
@@ -476,6 +792,13 @@ namespace snmalloc
 
       Remote* last;
 
+      /**
+       * The allocator this list was last sent to, and the last message sent
+       * to it, which lets the next send detect other senders.
+       */
+      RemoteAllocator* sent_to = nullptr;
+      Remote* sent = nullptr;
+
       RemoteList()
       {
         clear();
@@ -503,6 +826,24 @@ namespace snmalloc
        * and lazily provide a real allocator.
        */
       int64_t capacity = 0;
+
+      /**
+       * The value `capacity` was last reset to.  This adapts between
+       * `REMOTE_CACHE_MIN` and `REMOTE_CACHE`, see `adapt`.
+       */
+      int64_t cache_size = REMOTE_CACHE;
+
+      /**
+       * `capacity` at the last post, so we know how many bytes were cached.
+       */
+      int64_t last_capacity = 0;
+
+      /**
+       * Number of messages cached since the last post, counting each object
+       * in a batch as a message of its own.
+       */
+      size_t messages = 0;
+
       RemoteList list[REMOTE_SLOTS];
 
       /// Used to find the index into the array of queues for remote
@@ -522,16 +863,46 @@ namespace snmalloc
         return (id >> (initial_shift + (r * REMOTE_SLOT_BITS))) & REMOTE_MASK;
       }
 
+      /**
+       * Cache a remote free.  Consecutive frees of small objects from the
+       * same slab become a single message, so that the owner handles them
+       * together, and its queue sees one message rather than many.
+       */
       SNMALLOC_FAST_PATH void
       dealloc_sized(alloc_id_t target_id, void* p, size_t objectsize)
       {
         this->capacity -= objectsize;
+        this->messages++;
 
         Remote* r = static_cast<Remote*>(p);
+        RemoteList* l = &list[get_slot(target_id, 0)];
+
+        if (
+          (objectsize <= MAX_SMALL_SIZE) && !l->empty() &&
+          (Metaslab::get_slab(l->last) == Metaslab::get_slab(r)))
+        {
+          l->last->add_to_batch(r);
+          SNMALLOC_ASSERT(message_target_id(l->last) == target_id);
+          return;
+        }
+
         r->set_target_id(target_id);
         SNMALLOC_ASSERT(r->target_id() == target_id);
 
-        RemoteList* l = &list[get_slot(target_id, 0)];
+        l->last->non_atomic_next = r;
+        l->last = r;
+      }
+
+      /**
+       * Cache a message, which may free a batch of objects, for another
+       * allocator without changing it.
+       */
+      void forward(Remote* r, size_t objectsize)
+      {
+        this->capacity -= objectsize;
+        this->messages++;
+
+        RemoteList* l = &list[get_slot(message_target_id(r), 0)];
         l->last->non_atomic_next = r;
         l->last = r;
       }
@@ -542,12 +913,35 @@ namespace snmalloc
         dealloc_sized(target_id, p, sizeclass_to_size(sizeclass));
       }
 
-      void post(alloc_id_t id)
+      /**
+       * Pick the size of the cache for the next round.  The aim is to send
+       * about `REMOTE_MESSAGES_PER_ENQUEUE` messages to each target, which
+       * keeps contention on the targets' queues low without holding more
+       * memory than that needs.  If a target is not keeping up with its
+       * queue, sending more often will not help it, so batch more instead.
+       */
+      void adapt(size_t posted, size_t enqueues, bool congested)
       {
-        // When the cache gets big, post lists to their target allocators.
-        capacity = REMOTE_CACHE;
+        int64_t used = last_capacity - capacity;
+        if ((posted == 0) || (enqueues == 0) || (used <= 0))
+          return;
+
+        int64_t average = used / static_cast<int64_t>(posted);
+        int64_t batch =
+          static_cast<int64_t>(enqueues * REMOTE_MESSAGES_PER_ENQUEUE);
+        int64_t wanted = congested ? cache_size * 2 : average * batch;
+        wanted = bits::min(bits::max(wanted, REMOTE_CACHE_MIN), REMOTE_CACHE);
+
+        cache_size = (cache_size + wanted) / 2;
+      }
 
+      void post(alloc_id_t id, Stats& stats)
+      {
+        // When the cache gets big, post lists to their target allocators.
         size_t post_round = 0;
+        size_t enqueues = 0;
+        size_t hops = 0;
+        bool congested = false;
 
         while (true)
         {
@@ -565,8 +959,14 @@ namespace snmalloc
             {
               // Send all slots to the target at the head of the list.
               Superslab* super = Superslab::get(first);
-              super->get_allocator()->message_queue.enqueue(first, l->last);
+              RemoteAllocator* target = super->get_allocator();
+              congested |= target->is_congested();
+              target->enqueue(
+                first, l->last, id, (l->sent_to == target) ? l->sent : nullptr);
+              l->sent_to = target;
+              l->sent = l->last;
               l->clear();
+              enqueues++;
             }
           }
 
@@ -587,14 +987,22 @@ namespace snmalloc
           {
             // Use the next N bits to spread out remote deallocs in our own
             // slot.
-            size_t slot = get_slot(r->target_id(), post_round);
+            size_t slot = get_slot(message_target_id(r), post_round);
             RemoteList* l = &list[slot];
             l->last->non_atomic_next = r;
             l->last = r;
 
             r = r->non_atomic_next;
+            hops++;
           }
         }
+
+        stats.remote_post(messages, enqueues, hops);
+        adapt(messages, enqueues, congested);
+
+        messages = 0;
+        capacity = cache_size;
+        last_capacity = capacity;
       }
     };
 
@@ -609,6 +1017,17 @@ namespace snmalloc
     std::conditional_t<IsQueueInline, RemoteAllocator, RemoteAllocator*>
       remote_alloc;
 
+    /**
+     * The next of the message queues to take a message from, once there are
+     * lanes.  `REMOTE_LANES` is the original queue.
+     */
+    size_t lane_cursor = 0;
+
+    /**
+     * The lane that `has_messages` looks at next, once there are lanes.
+     */
+    size_t lane_probe = 0;
+
 #ifdef CACHE_FRIENDLY_OFFSET
     size_t remote_offset = 0;
 
@@ -725,9 +1144,9 @@ namespace snmalloc
         }
       };
 
-      // Destroy the message queue so that it has no stub message.
-      {
-        Remote* p = message_queue().destroy();
+      // Destroy the message queues so that they have no stub messages.
+      auto destroy = [this](MPSCQ<Remote>& queue) {
+        Remote* p = queue.destroy();
 
         while (p != nullptr)
         {
@@ -735,6 +1154,13 @@ namespace snmalloc
           handle_dealloc_remote(p);
           p = n;
         }
+      };
+
+      destroy(message_queue());
+      if (RemoteLanes* l = lanes())
+      {
+        for (auto& lane : l->lane)
+          destroy(lane.queue);
       }
 
       // Dump bump allocators back into memory
@@ -782,7 +1208,7 @@ namespace snmalloc
       test(super_available);
       test(super_only_short_available);
 
-      // Place the static stub message on the queue.
+      // Place the static stub messages on the queues.
       init_message_queue();
     }
 
@@ -807,13 +1233,99 @@ namespace snmalloc
         static_cast<uint8_t*>(end_point_correction) - end_to_end);
     }
 
-    void init_message_queue()
+    Remote* new_message_stub()
     {
       // Manufacture an allocation to prime the queue
       // Using an actual allocation removes a conditional of a critical path.
       Remote* dummy = reinterpret_cast<Remote*>(alloc<YesZero>(MIN_ALLOC_SIZE));
       dummy->set_target_id(id());
-      message_queue().init(dummy);
+      return dummy;
+    }
+
+    void init_message_queue()
+    {
+      message_queue().init(new_message_stub());
+
+      if (RemoteLanes* l = lanes())
+      {
+        for (auto& lane : l->lane)
+          lane.queue.init(new_message_stub());
+      }
+    }
+
+    /**
+     * The extra message queues, if senders have contended enough on this
+     * allocator's queue for it to have added them.
+     */
+    RemoteLanes* lanes()
+    {
+      if constexpr (REMOTE_LANES > 1)
+        return public_state()->lanes.load(std::memory_order_relaxed);
+      else
+        return nullptr;
+    }
+
+    /**
+     * Add the extra message queues.  Senders that have not yet seen them may
+     * still use the original queue, so that stays in use as well.
+     */
+    SNMALLOC_SLOW_PATH void init_lanes()
+    {
+      // Allocating the stubs may handle messages, so finish that before
+      // checking whether the lanes have been added already.
+      Remote* stubs[REMOTE_LANES];
+      for (auto& stub : stubs)
+        stub = new_message_stub();
+
+      if (lanes() != nullptr)
+      {
+        for (auto stub : stubs)
+          dealloc(stub, MIN_ALLOC_SIZE);
+        return;
+      }
+
+      RemoteLanes* l = large_allocator.memory_provider
+                         .template alloc_chunk<RemoteLanes, CACHELINE_SIZE>();
+      for (size_t i = 0; i < REMOTE_LANES; i++)
+        l->lane[i].queue.init(stubs[i]);
+
+      public_state()->lanes.store(l, std::memory_order_release);
+    }
+
+    /**
+     * Take the next message from the message queues.  Once there are lanes,
+     * they and the original queue are visited in turn, so that no sender
+     * waits behind a busier one.
+     */
+    std::pair<Remote*, bool> dequeue_message()
+    {
+      RemoteLanes* l = lanes();
+      if (likely(l == nullptr))
+        return message_queue().dequeue();
+
+      for (size_t n = 0; n <= REMOTE_LANES; n++)
+      {
+        size_t i = lane_cursor;
+        lane_cursor = (lane_cursor + 1) % (REMOTE_LANES + 1);
+
+        auto& queue = (i == REMOTE_LANES) ? message_queue() : l->lane[i].queue;
+        auto r = queue.dequeue();
+        if (r.second)
+          return r;
+      }
+
+      return std::pair<Remote*, bool>(nullptr, false);
+    }
+
+    /**
+     * The id of the allocator that the message `r` is for.  Batch messages
+     * do not carry it, so it is found from the superslab they are in.
+     */
+    static alloc_id_t message_target_id(Remote* r)
+    {
+      if (r->is_batch())
+        return Superslab::get(r)->get_allocator()->id();
+      return r->target_id();
     }
 
     SNMALLOC_FAST_PATH void handle_dealloc_remote(Remote* p)
@@ -821,16 +1333,24 @@ namespace snmalloc
       Superslab* super = Superslab::get(p);
 
 #ifdef CHECK_CLIENT
-      if (p->target_id() != super->get_allocator()->id())
+      if (message_target_id(p) != super->get_allocator()->id())
         error("Detected memory corruption.  Potential use-after-free");
 #endif
       if (likely(super->get_kind() == Super))
       {
         Slab* slab = Metaslab::get_slab(p);
         Metaslab& meta = super->get_meta(slab);
-        if (likely(p->target_id() == id()))
+        if (likely(message_target_id(p) == id()))
         {
-          small_dealloc_offseted(super, p, meta.sizeclass);
+          if (likely(!p->is_batch()))
+          {
+            small_dealloc_offseted(super, p, meta.sizeclass);
+            return;
+          }
+
+          Remote* first;
+          size_t count = message_objects(p, first);
+          small_dealloc_remote_list(super, slab, first, p, count);
           return;
         }
       }
@@ -857,32 +1377,225 @@ namespace snmalloc
       }
       else
       {
-        SNMALLOC_ASSERT(likely(p->target_id() != id()));
+        SNMALLOC_ASSERT(likely(message_target_id(p) != id()));
         Slab* slab = Metaslab::get_slab(p);
         Metaslab& meta = super->get_meta(slab);
-        // Queue for remote dealloc elsewhere.
-        remote.dealloc(p->target_id(), p, meta.sizeclass);
+        // Queue for remote dealloc elsewhere, keeping any batch together.
+        remote.forward(p, sizeclass_to_size(meta.sizeclass));
+      }
+    }
+
+    /**
+     * Find the objects freed by the message `p`, which are linked through
+     * `non_atomic_next` from `first` to `p` itself, and return how many there
+     * are.
+     */
+    static size_t message_objects(Remote* p, Remote*& first)
+    {
+      if (!p->is_batch())
+      {
+        first = p;
+        return 1;
+      }
+
+      first = p->get_batch();
+      size_t count = p->get_batch_size() + 1;
+
+      // The first object holds the size of the batch rather than a free
+      // list check value.
+      Metaslab::store_next(first, first->non_atomic_next);
+      return count;
+    }
+
+    /**
+     * Free `count` objects from `slab`, which are linked as a free list from
+     * `first` to `last`.  The list is spliced onto the slab's free list as it
+     * is, and `Metaslab::needed` is updated once.
+     */
+    SNMALLOC_SLOW_PATH void small_dealloc_remote_list(
+      Superslab* super, Slab* slab, Remote* first, Remote* last, size_t count)
+    {
+      Metaslab& meta = super->get_meta(slab);
+      sizeclass_t sc = meta.sizeclass;
+
+      if (meta.needed <= count)
+      {
+        // The slab is full, or these are all of its remaining objects, so
+        // its status changes.  Free one object on its own, which takes the
+        // slow path at the right point, and splice the rest.
+        if (count == 1)
+        {
+          small_dealloc_offseted(super, first, sc);
+          return;
+        }
+
+        Remote* rest = first->non_atomic_next;
+        if (meta.is_full())
+        {
+          small_dealloc_offseted(super, first, sc);
+          small_dealloc_remote_list(super, slab, rest, last, count - 1);
+        }
+        else
+        {
+          small_dealloc_remote_list(super, slab, rest, last, count - 1);
+          small_dealloc_offseted(super, first, sc);
+        }
+        return;
+      }
+
+      for (size_t i = 0; i < count; i++)
+        stats().sizeclass_dealloc(sc);
+      meta.needed = static_cast<uint16_t>(meta.needed - count);
+
+      if constexpr (SLAB_BITMAP)
+      {
+        Remote* r = first;
+        for (size_t i = 0; i < count; i++)
+        {
+          Remote* next = r->non_atomic_next;
+          slab->free_object(meta, r);
+          r = next;
+        }
+      }
+      else
+      {
+        slab->free_list(meta, first, last);
+      }
+    }
+
+    /**
+     * A message waiting to be handled, and the later messages for the same
+     * slab that have been gathered into it.  `count` is zero until another
+     * message is gathered, and then the objects of all of them are linked as
+     * a free list from `first` to `last`.
+     */
+    struct PendingMessage
+    {
+      Remote* message;
+      Remote* first;
+      Remote* last;
+      size_t count;
+    };
+
+    /**
+     * Gather the message `q` into `pending` if they free small objects in the
+     * same slab of this allocator, and return whether it was.
+     */
+    bool gather_message(PendingMessage& pending, Remote* q)
+    {
+      Remote* p = pending.message;
+      if (Metaslab::get_slab(p) != Metaslab::get_slab(q))
+        return false;
+
+      Superslab* super = Superslab::get(p);
+      if ((super->get_kind() != Super) || (message_target_id(p) != id()))
+        return false;
+
+#ifdef CHECK_CLIENT
+      if (
+        (super->get_allocator() != public_state()) ||
+        (message_target_id(q) != id()))
+        error("Detected memory corruption.  Potential use-after-free");
+#endif
+      if (pending.count == 0)
+      {
+        pending.count = message_objects(p, pending.first);
+        pending.last = p;
+      }
+
+      Remote* q_first;
+      pending.count += message_objects(q, q_first);
+      Metaslab::store_next(pending.last, q_first);
+      pending.last = q;
+      return true;
+    }
+
+    void handle_pending_message(PendingMessage& pending)
+    {
+      if (pending.count == 0)
+      {
+        handle_dealloc_remote(pending.message);
+        return;
       }
+
+      Remote* p = pending.message;
+      small_dealloc_remote_list(
+        Superslab::get(p),
+        Metaslab::get_slab(p),
+        pending.first,
+        pending.last,
+        pending.count);
     }
 
-    SNMALLOC_SLOW_PATH void handle_message_queue_inner()
+    /**
+     * Handle at most `budget` messages from the queue, and return how many
+     * were handled.  Slow paths use `REMOTE_SLOW_PATH_BATCH`, so that the
+     * work each of them does is bounded.
+     *
+     * The metadata each message needs is prefetched when it is taken from
+     * the queue, and it is handled `REMOTE_DRAIN_WINDOW` messages later, so
+     * that the cache misses for several messages overlap rather than each
+     * waiting on the last.  Messages for a slab that already has one waiting
+     * are gathered into it, so that the slab is updated once for them all.
+     */
+    SNMALLOC_SLOW_PATH size_t
+    handle_message_queue_inner(size_t budget = REMOTE_SLOW_PATH_BATCH)
     {
-      for (size_t i = 0; i < REMOTE_BATCH; i++)
+      PendingMessage pending[REMOTE_DRAIN_WINDOW];
+      size_t oldest = 0;
+      size_t waiting = 0;
+
+      size_t i = 0;
+      for (; i < budget; i++)
       {
-        auto r = message_queue().dequeue();
+        auto r = dequeue_message();
 
         if (unlikely(!r.second))
           break;
 
-        handle_dealloc_remote(r.first);
+        Remote* q = r.first;
+        Superslab* super = Superslab::get(q);
+        Aal::prefetch(super);
+        Aal::prefetch(&super->get_meta(Metaslab::get_slab(q)));
+
+        bool gathered = false;
+        for (size_t j = 0; (j < waiting) && !gathered; j++)
+          gathered = gather_message(
+            pending[(oldest + j) % REMOTE_DRAIN_WINDOW], q);
+
+        if (gathered)
+          continue;
+
+        if (waiting == REMOTE_DRAIN_WINDOW)
+        {
+          handle_pending_message(pending[oldest]);
+          oldest = (oldest + 1) % REMOTE_DRAIN_WINDOW;
+          waiting--;
+        }
+
+        pending[(oldest + waiting) % REMOTE_DRAIN_WINDOW] = {q, q, q, 0};
+        waiting++;
+      }
+
+      for (size_t j = 0; j < waiting; j++)
+        handle_pending_message(pending[(oldest + j) % REMOTE_DRAIN_WINDOW]);
+
+      // Let senders know if we are not keeping up with our queue.
+      public_state()->set_congested((i == budget) && has_messages());
+
+      // Spread senders over more queues if they are contending on ours.
+      if constexpr (REMOTE_LANES > 1)
+      {
+        if (unlikely(public_state()->take_contention()) && (lanes() == nullptr))
+          init_lanes();
       }
 
       // Our remote queues may be larger due to forwarding remote frees.
       if (likely(remote.capacity > 0))
-        return;
+        return i;
 
-      stats().remote_post();
-      remote.post(id());
+      remote.post(id(), stats());
+      return i;
     }
 
     /**
@@ -891,7 +1604,29 @@ namespace snmalloc
      */
     SNMALLOC_FAST_PATH bool has_messages()
     {
-      return !(message_queue().is_empty());
+      if (!message_queue().is_empty())
+        return true;
+
+      // Only one lane is looked at per call, so that an allocator with lanes
+      // does not read every one of them on each slow path.  A message in
+      // another lane is found within `REMOTE_LANES` calls.
+      RemoteLanes* l = lanes();
+      if (likely(l == nullptr))
+        return false;
+      lane_probe = (lane_probe + 1) % REMOTE_LANES;
+      return !l->lane[lane_probe].queue.is_empty();
+    }
+
+    /**
+     * Like `has_messages`, but looks at every lane.
+     */
+    bool has_any_messages()
+    {
+      if (!message_queue().is_empty())
+        return true;
+
+      RemoteLanes* l = lanes();
+      return (l != nullptr) && !l->is_empty();
     }
 
     SNMALLOC_FAST_PATH void handle_message_queue()
@@ -909,7 +1644,7 @@ namespace snmalloc
       Superslab* super = super_available.get_head();
 
       if (super != nullptr)
-        return super;
+        return select_fullest_superslab(super);
 
       super = reinterpret_cast<Superslab*>(
         large_allocator.template alloc<NoZero, allow_reserve>(
@@ -924,6 +1659,30 @@ namespace snmalloc
       return super;
     }
 
+    /**
+     * Return the fullest of the first `OCCUPANCY_SCAN` superslabs with
+     * space, starting from `head`, and move it to the head of the list so
+     * that it is filled before the others.
+     */
+    Superslab* select_fullest_superslab(Superslab* head)
+    {
+      Superslab* best = head;
+      Superslab* curr = head->get_next();
+      for (size_t i = 1; (i < OCCUPANCY_SCAN) && (curr != nullptr); i++)
+      {
+        if (curr->get_used() > best->get_used())
+          best = curr;
+        curr = curr->get_next();
+      }
+
+      if (best != head)
+      {
+        super_available.remove(best);
+        super_available.insert(best);
+      }
+      return best;
+    }
+
     void reposition_superslab(Superslab* super)
     {
       switch (super->get_status())
@@ -970,7 +1729,8 @@ namespace snmalloc
 
         if (super != nullptr)
         {
-          Slab* slab = super->alloc_short_slab(sizeclass);
+          Slab* slab = super->alloc_short_slab(
+            sizeclass, large_allocator.memory_provider);
           SNMALLOC_ASSERT(super->is_full());
           return slab;
         }
@@ -980,7 +1740,8 @@ namespace snmalloc
         if (super == nullptr)
           return nullptr;
 
-        Slab* slab = super->alloc_short_slab(sizeclass);
+        Slab* slab =
+          super->alloc_short_slab(sizeclass, large_allocator.memory_provider);
         reposition_superslab(super);
         return slab;
       }
@@ -990,7 +1751,8 @@ namespace snmalloc
       if (super == nullptr)
         return nullptr;
 
-      Slab* slab = super->alloc_slab(sizeclass);
+      Slab* slab =
+        super->alloc_slab(sizeclass, large_allocator.memory_provider);
       reposition_superslab(super);
       return slab;
     }
@@ -1006,7 +1768,7 @@ namespace snmalloc
           zero_mem == YesZero ? "zeromem" : "nozeromem",
           allow_reserve == NoReserve ? "noreserve" : "reserve"));
 
-      SNMALLOC_ASSUME(size <= SLAB_SIZE);
+      SNMALLOC_ASSUME(size <= MAX_SMALL_SIZE);
       sizeclass_t sizeclass = size_to_sizeclass(size);
       return small_alloc_inner<zero_mem, allow_reserve>(sizeclass, size);
     }
@@ -1071,15 +1833,51 @@ namespace snmalloc
         stats().alloc_request(size);
         stats().sizeclass_alloc(sizeclass);
 
-        SlabLink* link = sl.get_next();
-        slab = get_slab(link);
+        slab = get_slab(select_fullest_slab(sl));
         auto& ffl = small_fast_free_lists[sizeclass];
-        return slab->alloc<zero_mem>(
+
+        // Taking the slab's free list makes all of its free objects
+        // available to allocate.
+        Metaslab& meta = slab->get_meta();
+        size_t bytes = static_cast<size_t>(meta.free_objects()) * rsize;
+
+        void* p = slab->alloc<zero_mem>(
           sl, ffl, rsize, large_allocator.memory_provider);
+        return profiler.alloc(
+          p, bytes, rsize, large_allocator.memory_provider);
       }
       return small_alloc_rare<zero_mem, allow_reserve>(sizeclass, size);
     }
 
+    /**
+     * Return the fullest of the first `OCCUPANCY_SCAN` slabs on a size class
+     * list, moved to the front of the list.  Filling it leaves the sparser
+     * slabs to drain and be returned to their superslabs.
+     */
+    static SlabLink* select_fullest_slab(SlabList& sl)
+    {
+      SlabLink* best = sl.get_next();
+      size_t best_free = get_slab(best)->get_meta().free_objects();
+      SlabLink* curr = best->get_next();
+      for (size_t i = 1; (i < OCCUPANCY_SCAN) && (curr != &sl); i++)
+      {
+        size_t curr_free = get_slab(curr)->get_meta().free_objects();
+        if (curr_free < best_free)
+        {
+          best = curr;
+          best_free = curr_free;
+        }
+        curr = curr->get_next();
+      }
+
+      if (best != sl.get_next())
+      {
+        best->remove();
+        sl.insert_next(best);
+      }
+      return best;
+    }
+
     /**
      * Called when there are no available free list to service this request
      * Could be due to using the dummy allocator, or needing to bump allocate a
@@ -1138,6 +1936,7 @@ namespace snmalloc
       auto rsize = sizeclass_to_size(sizeclass);
       auto& ffl = small_fast_free_lists[sizeclass];
       SNMALLOC_ASSERT(ffl.value == nullptr);
+      void* start = bp;
       Slab::alloc_new_list(bp, ffl, rsize);
 
       void* p = remove_cache_friendly_offset(ffl.value, sizeclass);
@@ -1147,7 +1946,8 @@ namespace snmalloc
       {
         large_allocator.memory_provider.zero(p, sizeclass_to_size(sizeclass));
       }
-      return p;
+      return profiler.alloc(
+        p, pointer_diff(start, bp), rsize, large_allocator.memory_provider);
     }
 
     /**
@@ -1163,12 +1963,136 @@ namespace snmalloc
       Slab* slab = alloc_slab<allow_reserve>(sizeclass);
       if (slab == nullptr)
         return nullptr;
-      bp =
-        pointer_offset(slab, get_initial_offset(sizeclass, slab->is_short()));
+      if constexpr (SLAB_BITMAP)
+        slab->clear_bitmap(sizeclass);
+
+      chunkmap().set_slab_owner(slab, public_state(), sizeclass);
+
+      bool is_short = slab->is_short();
+      bp = pointer_offset(
+        slab,
+        get_initial_offset(sizeclass, is_short) -
+          get_slab_colour(sizeclass, address_cast(slab), is_short));
 
       return small_alloc_build_free_list<zero_mem, allow_reserve>(sizeclass);
     }
 
+    /**
+     * Fill `out` with `n` objects of a small sizeclass.  Whole fast free
+     * lists are drained at a time, and refilled through the usual slow path,
+     * which steals an entire slab's free list or builds a new one from the
+     * bump allocator.
+     */
+    template<ZeroMem zero_mem, AllowReserve allow_reserve>
+    SNMALLOC_SLOW_PATH size_t
+    small_alloc_batch(sizeclass_t sizeclass, void** out, size_t n)
+    {
+      if (unlikely(NeedsInitialisation(this)))
+      {
+        auto replacement = InitThreadAllocator();
+        return reinterpret_cast<Allocator*>(replacement)
+          ->template small_alloc_batch<zero_mem, allow_reserve>(
+            sizeclass, out, n);
+      }
+
+      size_t rsize = sizeclass_to_size(sizeclass);
+      auto& fl = small_fast_free_lists[sizeclass];
+      size_t i = 0;
+
+      while (i < n)
+      {
+        void* head = fl.value;
+        while ((head != nullptr) && (i < n))
+        {
+          stats().alloc_request(rsize);
+          stats().sizeclass_alloc(sizeclass);
+          void* next = Metaslab::follow_next(head);
+          void* p = remove_cache_friendly_offset(head, sizeclass);
+          if constexpr (zero_mem == YesZero)
+          {
+            large_allocator.memory_provider.zero(p, rsize);
+          }
+          out[i++] = p;
+          head = next;
+        }
+        fl.value = head;
+
+        if (i == n)
+          break;
+
+        // The fast free list is empty, so this takes the slow path and
+        // installs a fresh free list for the next iteration.
+        void* p = small_alloc_inner<zero_mem, allow_reserve>(sizeclass, rsize);
+        if (p == nullptr)
+          break;
+        out[i++] = p;
+      }
+      return i;
+    }
+
+    /**
+     * Free `n` objects of a small sizeclass.  Runs of objects in the same
+     * slab owned by this allocator are added to the slab's free objects
+     * with a single update to `Metaslab::needed`, provided that this does
+     * not change the slab's status.  Everything else takes
+     * the usual per-object path.
+     */
+    void small_dealloc_batch(sizeclass_t sizeclass, void** ptrs, size_t n)
+    {
+      for (size_t i = 0; i < n; i++)
+        HeapProfiler::dealloc(ptrs[i]);
+
+      size_t i = 0;
+      while (i < n)
+      {
+        void* p = ptrs[i];
+        Superslab* super = Superslab::get(p);
+        RemoteAllocator* target = super->get_allocator();
+
+        if (target != public_state())
+        {
+          remote_dealloc(target, p, sizeclass);
+          i++;
+          continue;
+        }
+
+        // Find the run of objects in the same slab.
+        Slab* slab = Metaslab::get_slab(p);
+        size_t end = i + 1;
+        while ((end < n) && (Metaslab::get_slab(ptrs[end]) == slab))
+          end++;
+
+        size_t count = end - i;
+        Metaslab& meta = super->get_meta(slab);
+        if (count == 1 || meta.needed <= count)
+        {
+          // Either a single object, or the slab is full or about to become
+          // empty, so its status changes.
+          for (; i < end; i++)
+            small_dealloc(super, ptrs[i], sizeclass);
+          continue;
+        }
+
+#ifdef CHECK_CLIENT
+        if (meta.is_unused())
+          error("Detected potential double free.");
+#endif
+
+        for (; i < end; i++)
+        {
+#ifdef CHECK_CLIENT
+          if (!slab->is_start_of_object(super, ptrs[i]))
+            error("Not deallocating start of an object");
+#endif
+          stats().sizeclass_dealloc(sizeclass);
+          void* offseted = apply_cache_friendly_offset(ptrs[i], sizeclass);
+          slab->free_object(meta, offseted);
+        }
+        meta.needed = static_cast<uint16_t>(meta.needed - count);
+        SNMALLOC_ASSERT(meta.valid_head());
+      }
+    }
+
     SNMALLOC_FAST_PATH void
     small_dealloc(Superslab* super, void* p, sizeclass_t sizeclass)
     {
@@ -1209,7 +2133,8 @@ namespace snmalloc
       bool was_full = super->is_full();
       SlabList* sl = &small_classes[sizeclass];
       Slab* slab = Metaslab::get_slab(p);
-      Superslab::Action a = slab->dealloc_slow(sl, super, p);
+      Superslab::Action a =
+        slab->dealloc_slow(sl, super, p, large_allocator.memory_provider);
       if (likely(a == Superslab::NoSlabReturn))
         return;
       stats().sizeclass_dealloc_slab(sizeclass);
@@ -1257,6 +2182,60 @@ namespace snmalloc
       }
     }
 
+    template<ZeroMem zero_mem, AllowReserve allow_reserve>
+    SNMALLOC_SLOW_PATH void*
+    alloc_aligned_slow(size_t alignment, size_t size, size_t asize)
+    {
+      handle_message_queue();
+
+      if (asize <= sizeclass_to_size(NUM_SIZECLASSES - 1))
+      {
+        // Every medium slot is page aligned, so only stronger alignments can
+        // be given a smaller size class.
+        sizeclass_t sizeclass = size_to_sizeclass(size);
+        if (
+          (alignment > OS_PAGE_SIZE) && (sizeclass >= NUM_SMALL_CLASSES) &&
+          (sizeclass != size_to_sizeclass(asize)))
+        {
+          void* p = medium_alloc_aligned<zero_mem>(sizeclass, size, alignment);
+          if (p != nullptr)
+            return p;
+        }
+
+        sizeclass = size_to_sizeclass(asize);
+        size_t rsize = sizeclass_to_size(sizeclass);
+        return medium_alloc<zero_mem, allow_reserve>(sizeclass, rsize, asize);
+      }
+
+      return large_alloc_aligned<zero_mem, allow_reserve>(alignment, size);
+    }
+
+    /**
+     * Allocate from a medium slab of the given size class that is already in
+     * use and has a free slot aligned to `alignment`.  Returns nullptr if
+     * there is none, rather than creating a slab that may have few aligned
+     * slots.
+     */
+    template<ZeroMem zero_mem>
+    void* medium_alloc_aligned(
+      sizeclass_t sizeclass, size_t size, size_t alignment)
+    {
+      DLList<Mediumslab>* sc =
+        &medium_classes[sizeclass - NUM_SMALL_CLASSES];
+      Mediumslab* slab = sc->get_head();
+      if ((slab == nullptr) || !slab->prefer_aligned(alignment))
+        return nullptr;
+
+      void* p = slab->alloc<zero_mem>(size, large_allocator.memory_provider);
+      if (slab->full())
+        sc->pop();
+
+      size_t rsize = sizeclass_to_size(sizeclass);
+      stats().alloc_request(size);
+      stats().sizeclass_alloc(sizeclass);
+      return profiler.alloc(p, rsize, rsize, large_allocator.memory_provider);
+    }
+
     template<ZeroMem zero_mem, AllowReserve allow_reserve>
     void* medium_alloc(sizeclass_t sizeclass, size_t rsize, size_t size)
     {
@@ -1307,14 +2286,14 @@ namespace snmalloc
 
       stats().alloc_request(size);
       stats().sizeclass_alloc(sizeclass);
-      return p;
+      return profiler.alloc(p, rsize, rsize, large_allocator.memory_provider);
     }
 
     void medium_dealloc(Mediumslab* slab, void* p, sizeclass_t sizeclass)
     {
       MEASURE_TIME(medium_dealloc, 4, 16);
       stats().sizeclass_dealloc(sizeclass);
-      bool was_full = slab->dealloc(p);
+      bool was_full = slab->dealloc(p, large_allocator.memory_provider);
 
 #ifdef CHECK_CLIENT
       if (!is_multiple_of_sizeclass(
@@ -1377,7 +2356,77 @@ namespace snmalloc
         stats().alloc_request(size);
         stats().large_alloc(large_class);
       }
-      return p;
+
+      size_t rsize = bits::align_up(size, SUPERSLAB_SIZE);
+      return profiler.alloc(p, rsize, rsize, large_allocator.memory_provider);
+    }
+
+    /**
+     * Allocate a large chunk aligned to `alignment`.  Chunks are aligned to
+     * their size, so a stronger alignment is first sought among the free
+     * chunks of the right size in this allocator's cache.  Failing that, a
+     * chunk of the alignment's size is allocated and its tail returned to
+     * the large stacks.
+     */
+    template<ZeroMem zero_mem, AllowReserve allow_reserve>
+    void* large_alloc_aligned(size_t alignment, size_t size)
+    {
+      size = bits::max(size, SUPERSLAB_SIZE);
+      size_t size_bits = bits::next_pow2_bits(size);
+      size_t align_bits = bits::next_pow2_bits(alignment);
+      // Direct reservations are only aligned to a superslab.
+      bool direct = large_allocator.is_direct(
+        bits::max(bits::align_up(size, SUPERSLAB_SIZE), alignment));
+      if ((align_bits <= size_bits) && !direct)
+        return large_alloc<zero_mem, allow_reserve>(size);
+
+      size_t chunk_bits = bits::max(align_bits, size_bits);
+      if ((chunk_bits - SUPERSLAB_BITS) >= NUM_LARGE_CLASSES)
+        return nullptr;
+
+      if (NeedsInitialisation(this))
+      {
+        void* replacement = InitThreadAllocator();
+        return reinterpret_cast<Allocator*>(replacement)
+          ->template large_alloc_aligned<zero_mem, allow_reserve>(
+            alignment, size);
+      }
+
+      size_t large_class = size_bits - SUPERSLAB_BITS;
+      void* p;
+      if (direct)
+      {
+        p = large_allocator.alloc_direct(
+          size, bits::max(alignment, SUPERSLAB_SIZE));
+        if (p == nullptr)
+          return nullptr;
+      }
+      else
+      {
+        p = large_allocator.template alloc_aligned<zero_mem>(
+          large_class, size, alignment);
+        if (p == nullptr)
+        {
+          p = large_alloc<zero_mem, allow_reserve>(alignment);
+          if (p == nullptr)
+            return nullptr;
+
+          // Return the tail beyond `size`.  If that is refused, the whole
+          // chunk is kept on purpose: it is aligned and at least `size`
+          // bytes, and the chunkmap records its real size for `alloc_size`.
+          bool trimmed = resize_large_in_place(p, size);
+          SNMALLOC_ASSERT(trimmed || (alloc_size(p) >= size));
+          UNUSED(trimmed);
+          return p;
+        }
+      }
+
+      chunkmap().set_large_size(p, size);
+      stats().alloc_request(size);
+      stats().large_alloc(large_class);
+
+      size_t rsize = bits::align_up(size, SUPERSLAB_SIZE);
+      return profiler.alloc(p, rsize, rsize, large_allocator.memory_provider);
     }
 
     void large_dealloc(void* p, size_t size)
@@ -1399,10 +2448,53 @@ namespace snmalloc
 
       stats().large_dealloc(large_class);
 
-      // Initialise in order to set the correct SlabKind.
-      Largeslab* slab = static_cast<Largeslab*>(p);
-      slab->init();
-      large_allocator.dealloc(slab, large_class);
+      large_allocator.dealloc_large(p, bits::align_up(size, SUPERSLAB_SIZE));
+    }
+
+    /**
+     * Take the free chunks covering `[start, end)` from the large stacks, to
+     * grow a large allocation in place.  At each step this takes the largest
+     * free chunk starting there, returning any part of it beyond `end`.  If
+     * there is none, the chunks taken so far are returned and this fails.
+     */
+    bool take_large_range(void* start, void* end)
+    {
+      address_t curr = address_cast(start);
+      address_t last = address_cast(end);
+      while (curr < last)
+      {
+        size_t chunk_bits =
+          bits::min(bits::ctz(curr), bits::ADDRESS_BITS - 1);
+        bool decommitted;
+        // A chunk in use is never in the large stacks, so they are only
+        // searched when nothing is allocated at `curr`.
+        bool in_use = chunkmap().get(curr) != CMNotOurs;
+        while (in_use ||
+               !large_allocator.take_chunk(
+                 pointer_cast<void>(curr),
+                 chunk_bits - SUPERSLAB_BITS,
+                 decommitted))
+        {
+          if (in_use || (chunk_bits == SUPERSLAB_BITS))
+          {
+            large_allocator.dealloc_range(start, curr - address_cast(start));
+            return false;
+          }
+          chunk_bits--;
+        }
+
+        size_t chunk_size = bits::one_at_bit(chunk_bits);
+        stats().superslab_pop();
+        stats().chunk_alloc(chunk_size);
+        if (curr + chunk_size > last)
+        {
+          large_allocator.dealloc_range(
+            end, curr + chunk_size - last, decommitted);
+          return true;
+        }
+        curr += chunk_size;
+      }
+      return true;
     }
 
     // This is still considered the fast path as all the complex code is tail
@@ -1452,8 +2544,7 @@ namespace snmalloc
       void* offseted = apply_cache_friendly_offset(p, sizeclass);
       remote.dealloc(target->id(), offseted, sizeclass);
 
-      stats().remote_post();
-      remote.post(id());
+      remote.post(id(), stats());
     }
 
     ChunkMap& chunkmap()
@@ -30,15 +30,90 @@ namespace snmalloc
 #endif
     ;
 
+  // The remote cache adapts its size between this and REMOTE_CACHE.
+  static constexpr int64_t REMOTE_CACHE_MIN =
+#ifdef USE_REMOTE_CACHE_MIN
+    USE_REMOTE_CACHE_MIN
+#else
+    REMOTE_CACHE / 16
+#endif
+    ;
+
+  // The remote cache is sized to aim for this many messages in each batch
+  // enqueued on a target allocator's message queue.
+  static constexpr size_t REMOTE_MESSAGES_PER_ENQUEUE =
+#ifdef USE_REMOTE_MESSAGES_PER_ENQUEUE
+    USE_REMOTE_MESSAGES_PER_ENQUEUE
+#else
+    128
+#endif
+    ;
+
   // Handle at most this many object from the remote dealloc queue at a time.
   static constexpr size_t REMOTE_BATCH =
 #ifdef USE_REMOTE_BATCH
-    REMOTE_BATCH
+    USE_REMOTE_BATCH
 #else
     4096
 #endif
     ;
 
+  // Handle at most this many objects from the remote dealloc queue when an
+  // allocation or deallocation slow path finds messages waiting.  Smaller
+  // values spread the work over more slow paths, bounding the latency any
+  // single call pays.  Anything left is handled by later slow paths, or by
+  // `Allocator::drain_messages`.
+  static constexpr size_t REMOTE_SLOW_PATH_BATCH =
+#ifdef USE_REMOTE_SLOW_PATH_BATCH
+    USE_REMOTE_SLOW_PATH_BATCH
+#else
+    REMOTE_BATCH
+#endif
+    ;
+
+  static_assert(
+    (REMOTE_SLOW_PATH_BATCH > 0) && (REMOTE_SLOW_PATH_BATCH <= REMOTE_BATCH),
+    "REMOTE_SLOW_PATH_BATCH must be between 1 and REMOTE_BATCH");
+
+  // Handle each message from the remote dealloc queue this many messages
+  // after taking it, so that the prefetch of its metadata has completed.
+  // Messages for a slab that already has one waiting are applied with it.
+  static constexpr size_t REMOTE_DRAIN_WINDOW =
+#ifdef USE_REMOTE_DRAIN_WINDOW
+    USE_REMOTE_DRAIN_WINDOW
+#else
+    16
+#endif
+    ;
+
+  static_assert(
+    REMOTE_DRAIN_WINDOW > 0, "REMOTE_DRAIN_WINDOW must be at least 1");
+
+  // An allocator whose message queue is contended by many senders adds this
+  // many more queues, and each sender uses one of them picked by its id.  1
+  // turns this off.
+  static constexpr size_t REMOTE_LANES =
+#ifdef USE_REMOTE_LANES
+    USE_REMOTE_LANES
+#else
+    8
+#endif
+    ;
+
+  static_assert(
+    bits::next_pow2_const(REMOTE_LANES) == REMOTE_LANES,
+    "REMOTE_LANES must be a power of two");
+
+  // Add the queues after senders have found another sender enqueuing at the
+  // same time this many times between two visits by the owner.
+  static constexpr size_t REMOTE_LANE_CONTENTION =
+#ifdef USE_REMOTE_LANE_CONTENTION
+    USE_REMOTE_LANE_CONTENTION
+#else
+    16
+#endif
+    ;
+
   // Specifies smaller slab and super slab sizes for address space
   // constrained scenarios.
   static constexpr size_t ADDRESS_SPACE_CONSTRAINED =
@@ -72,7 +147,14 @@ namespace snmalloc
      * Decommit superslabs only when we are informed of memory pressure by the
      * OS, do not decommit anything in normal operation.
      */
-    DecommitSuperLazy
+    DecommitSuperLazy,
+    /**
+     * Do not decommit on deallocation.  Superslabs and large allocations that
+     * have been sitting unused for longer than `DECOMMIT_DECAY_MS` are
+     * decommitted in bulk, either by a periodic tick on the large allocation
+     * slow path or by an explicit call from a purge thread.
+     */
+    DecommitSuperDecay
   };
 
   static constexpr DecommitStrategy decommit_strategy =
@@ -85,6 +167,98 @@ namespace snmalloc
 #endif
     ;
 
+  // With the DecommitSuperDecay strategy, chunks that have been unused for
+  // this many milliseconds are decommitted.
+  static constexpr uint64_t DECOMMIT_DECAY_MS =
+#ifdef USE_DECOMMIT_DECAY_MS
+    USE_DECOMMIT_DECAY_MS
+#else
+    1000
+#endif
+    ;
+
+  // With the DecommitSuper strategy, each superslab keeps this many of its
+  // most recently freed slabs committed, as they are the next to be reused.
+  // Slabs freed before them are decommitted, so that a few long-lived
+  // objects do not keep a whole superslab resident.
+  static constexpr size_t DECOMMIT_SLAB_RETAIN =
+#ifdef USE_DECOMMIT_SLAB_RETAIN
+    USE_DECOMMIT_SLAB_RETAIN
+#else
+    4
+#endif
+    ;
+
+  // With the DecommitSuper strategy, free objects in medium slabs of at
+  // least this size are decommitted, and committed again when they are
+  // allocated.  Zero disables this.
+  static constexpr size_t MEDIUM_DECOMMIT_SIZE =
+#ifdef USE_MEDIUM_DECOMMIT_SIZE
+    USE_MEDIUM_DECOMMIT_SIZE
+#else
+    256 * 1024
+#endif
+    ;
+
+  // When picking a slab of a size class or a superslab to allocate from,
+  // look at this many of the most recently freed into and take the fullest,
+  // so that sparse ones are left to drain and be returned.  One takes the
+  // most recent.
+  static constexpr size_t OCCUPANCY_SCAN =
+#ifdef USE_OCCUPANCY_SCAN
+    USE_OCCUPANCY_SCAN
+#else
+    4
+#endif
+    ;
+
+  // Large classes below this value (counting superslabs as class 0) are
+  // hinted to be backed by huge pages on platforms that support it.  Zero
+  // disables huge page backing.  This is the default for new memory
+  // providers and can be adjusted per provider.
+  static constexpr size_t HUGE_PAGE_LARGE_CLASSES =
+#ifdef USE_HUGE_PAGE_LARGE_CLASSES
+    USE_HUGE_PAGE_LARGE_CLASSES
+#else
+    0
+#endif
+    ;
+
+  // Number of NUMA nodes that the memory provider and allocator pool keep
+  // separate free lists for.  Threads on nodes beyond this share lists
+  // (modulo this value).  Must be a power of two.  The default of one
+  // disables NUMA awareness.
+  static constexpr size_t NUMA_NODES =
+#ifdef USE_NUMA_NODES
+    USE_NUMA_NODES
+#else
+    1
+#endif
+    ;
+
+  // With SNMALLOC_HEAP_PROFILE, sample on average one allocation every this
+  // many bytes allocated.
+  static constexpr size_t HEAP_PROFILE_INTERVAL =
+#ifdef USE_HEAP_PROFILE_INTERVAL
+    USE_HEAP_PROFILE_INTERVAL
+#else
+    512 * 1024
+#endif
+    ;
+
+  // The most live samples the heap profiler keeps.  Further samples are
+  // counted as dropped until some are freed.  Must be a power of two.
+  static constexpr size_t HEAP_PROFILE_SAMPLES =
+#ifdef USE_HEAP_PROFILE_SAMPLES
+    USE_HEAP_PROFILE_SAMPLES
+#else
+    1 << 14
+#endif
+    ;
+
+  // The most stack frames recorded for each heap profile sample.
+  static constexpr size_t HEAP_PROFILE_DEPTH = 32;
+
   // The remaining values are derived, not configurable.
   static constexpr size_t POINTER_BITS =
     bits::next_pow2_bits_const(sizeof(uintptr_t));
@@ -127,6 +301,83 @@ namespace snmalloc
 
   static_assert((1ULL << SUPERSLAB_BITS) == SUPERSLAB_SIZE, "Sanity check");
 
+  // Small size classes must fit at least this many objects in a slab.
+  // Larger classes, down to the first that is a whole number of pages, are
+  // medium classes, with slabs that span a superslab, so that they are not
+  // given a slab for every few objects and do not waste the end of each
+  // slab.  Must be a power of two.
+  static constexpr size_t SLAB_MIN_OBJECTS =
+#ifdef USE_SLAB_MIN_OBJECTS
+    USE_SLAB_MIN_OBJECTS
+#else
+    4
+#endif
+    ;
+
+  static_assert(
+    bits::next_pow2_const(SLAB_MIN_OBJECTS) == SLAB_MIN_OBJECTS,
+    "SLAB_MIN_OBJECTS must be a power of two");
+
+  // The largest small object.  Medium objects are page aligned, so every
+  // medium class must be a whole number of pages.
+  static constexpr size_t MAX_SMALL_SIZE = bits::min(
+    SLAB_SIZE, bits::max(SLAB_SIZE / SLAB_MIN_OBJECTS, PAGE_ALIGNED_SIZE));
+
+  // Colour slabs: move the objects in each slab towards its start, into the
+  // space left over by the size class, by a number of cache lines that
+  // rotates from slab to slab.  Objects at the same index in different slabs
+  // then map to different cache sets.
+  static constexpr bool SLAB_COLOURING =
+#ifdef USE_SLAB_COLOURING
+    USE_SLAB_COLOURING
+#else
+    false
+#endif
+    ;
+
+  // Track the free objects of a small slab in a bitmap at the start of the
+  // slab, rather than in a list threaded through the objects.  Free lists
+  // built from it are in address order, and whether an object is free can be
+  // read without walking a list.
+  static constexpr bool SLAB_BITMAP =
+#ifdef USE_SLAB_BITMAP
+    USE_SLAB_BITMAP
+#else
+    false
+#endif
+    ;
+
+  // Large allocations of at least this size are reserved directly from the
+  // platform, and returned to it when freed, on platforms that support it.
+  // Zero disables this, so that all large allocations use the large stacks.
+  static constexpr size_t LARGE_DIRECT_SIZE =
+#ifdef USE_LARGE_DIRECT_SIZE
+    USE_LARGE_DIRECT_SIZE
+#else
+    0
+#endif
+    ;
+
+  // Each allocator keeps a cache of free chunks in front of the shared large
+  // stacks, holding up to this many superslabs' worth of chunks of each of
+  // the smallest large classes: this many superslabs, half as many chunks of
+  // twice the size, and so on.  Zero disables the cache.
+  static constexpr size_t LARGE_CACHE_SIZE =
+#ifdef USE_LARGE_CACHE_SIZE
+    USE_LARGE_CACHE_SIZE
+#else
+    4
+#endif
+    ;
+
+  static_assert(
+    bits::next_pow2_const(NUMA_NODES) == NUMA_NODES,
+    "NUMA_NODES must be a power of two");
+
+  static_assert(
+    bits::next_pow2_const(HEAP_PROFILE_SAMPLES) == HEAP_PROFILE_SAMPLES,
+    "HEAP_PROFILE_SAMPLES must be a power of two");
+
   // Number of slots for remote deallocation.
   static constexpr size_t REMOTE_SLOT_BITS = 6;
   static constexpr size_t REMOTE_SLOTS = 1 << REMOTE_SLOT_BITS;
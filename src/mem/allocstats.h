@@ -3,6 +3,7 @@
 #include "../ds/bits.h"
 #include "../mem/sizeclass.h"
 
+#include <atomic>
 #include <cstdint>
 
 #ifdef USE_SNMALLOC_STATS
@@ -15,6 +16,34 @@
 
 namespace snmalloc
 {
+  /**
+   * A counter that is only written by one thread, but may be read by others.
+   * Updates are a relaxed load and store, which is as cheap as a plain
+   * increment.
+   */
+  class RelaxedCounter
+  {
+    std::atomic<size_t> value{0};
+
+  public:
+    void add(size_t n)
+    {
+      value.store(
+        value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void sub(size_t n)
+    {
+      value.store(
+        value.load(std::memory_order_relaxed) - n, std::memory_order_relaxed);
+    }
+
+    size_t get() const
+    {
+      return value.load(std::memory_order_relaxed);
+    }
+  };
+
   template<size_t N, size_t LARGE_N>
   struct AllocStats
   {
@@ -117,6 +146,17 @@ namespace snmalloc
 #endif
     };
 
+    /**
+     * Counters kept in every build, so that `mallctl` can report them.  Each
+     * allocator only updates its own.  Large allocations and chunks are
+     * counted down by the allocator that frees them, which may not be the
+     * one that counted them up, so the counters of a single allocator may
+     * wrap around.  Their sum over all allocators is exact.
+     */
+    RelaxedCounter live_count[N];
+    RelaxedCounter large_live_count[LARGE_N];
+    RelaxedCounter active_bytes;
+
 #ifdef USE_SNMALLOC_STATS
     static constexpr size_t BUCKETS_BITS = 4;
     static constexpr size_t BUCKETS = 1 << BUCKETS_BITS;
@@ -132,6 +172,10 @@ namespace snmalloc
     size_t remote_freed = 0;
     size_t remote_posted = 0;
     size_t remote_received = 0;
+    size_t remote_post_count = 0;
+    size_t remote_messages_posted = 0;
+    size_t remote_enqueues = 0;
+    size_t remote_forward_hops = 0;
     size_t superslab_push_count = 0;
     size_t superslab_pop_count = 0;
     size_t superslab_fresh_count = 0;
@@ -173,7 +217,7 @@ namespace snmalloc
 
     void sizeclass_alloc(sizeclass_t sc)
     {
-      UNUSED(sc);
+      live_count[sc].add(1);
 
 #ifdef USE_SNMALLOC_STATS
       sizeclass[sc].addToRunningAverage();
@@ -183,7 +227,7 @@ namespace snmalloc
 
     void sizeclass_dealloc(sizeclass_t sc)
     {
-      UNUSED(sc);
+      live_count[sc].sub(1);
 
 #ifdef USE_SNMALLOC_STATS
       sizeclass[sc].addToRunningAverage();
@@ -193,7 +237,7 @@ namespace snmalloc
 
     void large_alloc(size_t sc)
     {
-      UNUSED(sc);
+      large_live_count[sc].add(1);
 
 #ifdef USE_SNMALLOC_STATS
       large_pop_count[sc]++;
@@ -222,13 +266,27 @@ namespace snmalloc
 
     void large_dealloc(size_t sc)
     {
-      UNUSED(sc);
+      large_live_count[sc].sub(1);
 
 #ifdef USE_SNMALLOC_STATS
       large_push_count[sc]++;
 #endif
     }
 
+    /**
+     * A chunk of `size` bytes was taken from, or returned to, the memory
+     * provider.
+     */
+    void chunk_alloc(size_t size)
+    {
+      active_bytes.add(size);
+    }
+
+    void chunk_dealloc(size_t size)
+    {
+      active_bytes.sub(size);
+    }
+
     void segment_create()
     {
 #ifdef USE_SNMALLOC_STATS
@@ -266,10 +324,23 @@ namespace snmalloc
 #endif
     }
 
-    void remote_post()
+    /**
+     * Record a post of the remote cache, which sent `messages` messages in
+     * `enqueues` batches, and forwarded messages between slots `hops` times
+     * while resolving slot collisions.
+     */
+    void remote_post(size_t messages, size_t enqueues, size_t hops)
     {
+      UNUSED(messages);
+      UNUSED(enqueues);
+      UNUSED(hops);
+
 #ifdef USE_SNMALLOC_STATS
       remote_posted = remote_freed;
+      remote_post_count++;
+      remote_messages_posted += messages;
+      remote_enqueues += enqueues;
+      remote_forward_hops += hops;
 #endif
     }
 
@@ -284,7 +355,13 @@ namespace snmalloc
 
     void add(AllocStats<N, LARGE_N>& that)
     {
-      UNUSED(that);
+      for (size_t i = 0; i < N; i++)
+        live_count[i].add(that.live_count[i].get());
+
+      for (size_t i = 0; i < LARGE_N; i++)
+        large_live_count[i].add(that.large_live_count[i].get());
+
+      active_bytes.add(that.active_bytes.get());
 
 #ifdef USE_SNMALLOC_STATS
       for (size_t i = 0; i < N; i++)
@@ -302,6 +379,10 @@ namespace snmalloc
       remote_freed += that.remote_freed;
       remote_posted += that.remote_posted;
       remote_received += that.remote_received;
+      remote_post_count += that.remote_post_count;
+      remote_messages_posted += that.remote_messages_posted;
+      remote_enqueues += that.remote_enqueues;
+      remote_forward_hops += that.remote_forward_hops;
       superslab_pop_count += that.superslab_pop_count;
       superslab_push_count += that.superslab_push_count;
       superslab_fresh_count += that.superslab_fresh_count;
@@ -332,7 +413,11 @@ namespace snmalloc
             << "Superslab pop"
             << "Superslab push"
             << "Superslab fresh"
-            << "Segments" << csv.endl;
+            << "Segments"
+            << "Remote posts"
+            << "Remote messages"
+            << "Remote enqueues"
+            << "Remote forward hops" << csv.endl;
 
         csv << "BucketedStats"
             << "DumpID"
@@ -406,7 +491,8 @@ namespace snmalloc
       csv << "GlobalStats" << dumpid << allocatorid << remote_freed
           << remote_posted << remote_received << superslab_pop_count
           << superslab_push_count << superslab_fresh_count << segment_count
-          << csv.endl;
+          << remote_post_count << remote_messages_posted << remote_enqueues
+          << remote_forward_hops << csv.endl;
     }
 #endif
   };
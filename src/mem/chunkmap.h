@@ -21,8 +21,11 @@ namespace snmalloc
      * unused.
      *
      * Values SUPERSLAB_BITS (inclusive) through 64 (exclusive, as it would
-     * represent the entire address space) are used for log2(size) at the
-     * heads of large allocations.  See SuperslabMap::set_large_size.
+     * represent the entire address space) are used at the heads of large
+     * allocations, for log2 of their size rounded up to a power of two.
+     * Large allocations are a whole number of superslabs, and the exact
+     * number is recovered from how far the redirections below extend.  See
+     * SuperslabMap::set_large_size and get_large_size.
      *
      * Values 64 (inclusive) through 128 (exclusive) are used for entries
      * within a large allocation.  A value of x at pagemap entry p indicates
@@ -56,6 +59,25 @@ namespace snmalloc
     FlatPagemap<SUPERSLAB_BITS, uint8_t>,
     Pagemap<SUPERSLAB_BITS, uint8_t, 0>>;
 
+  /**
+   * The slab map records, for each small slab, the allocator that owns it and
+   * the size class of its objects, in a single word.  Freeing an object can
+   * then find both without reading the header of its superslab, which the
+   * owner writes to as it allocates and frees.  An entry of zero means that
+   * the slab is not known to be a small slab.
+   */
+  using SlabmapPagemap = Pagemap<SLAB_BITS, uintptr_t, 0>;
+
+  /**
+   * Allocators are cache line aligned, which leaves the bottom bits of their
+   * address free to hold a small size class in a slab map entry.
+   */
+  static constexpr uintptr_t SLABMAP_SIZECLASS_MASK =
+    alignof(RemoteAllocator) - 1;
+  static_assert(
+    NUM_SMALL_CLASSES <= SLABMAP_SIZECLASS_MASK + 1,
+    "Small size classes must fit in the alignment of an allocator");
+
   /**
    * Mixin used by `ChunkMap` to directly access the pagemap via a global
    * variable.  This should be used from within the library or program that
@@ -82,7 +104,7 @@ namespace snmalloc
     /**
      * Returns the pagemap.
      */
-    static ChunkmapPagemap& pagemap()
+    static T& pagemap()
     {
       return global_pagemap;
     }
@@ -90,6 +112,13 @@ namespace snmalloc
 
   using GlobalPagemap = GlobalPagemapTemplate<ChunkmapPagemap>;
 
+  /**
+   * The slab map is always private to the library or program, even when the
+   * chunk map is shared.  Objects from slabs of another instance have no
+   * entry in it, and are freed by reading their superslab header instead.
+   */
+  using GlobalSlabmap = GlobalPagemapTemplate<SlabmapPagemap>;
+
   /**
    * Optionally exported function that accesses the global pagemap provided by
    * a shared library.
@@ -141,7 +170,9 @@ namespace snmalloc
    * implementation (for example, to move pagemap updates to a different
    * protection domain).
    */
-  template<typename PagemapProvider = GlobalPagemap>
+  template<
+    typename PagemapProvider = GlobalPagemap,
+    typename SlabmapProvider = GlobalSlabmap>
   struct DefaultChunkMap
   {
     /**
@@ -179,12 +210,47 @@ namespace snmalloc
       set(slab, static_cast<size_t>(CMMediumslab));
     }
     /**
-     * Remove an entry from the pagemap corresponding to a superslab.
+     * Remove an entry from the pagemap corresponding to a superslab, and the
+     * slab map entries of its slabs.
      */
     static void clear_slab(Superslab* slab)
     {
       SNMALLOC_ASSERT(get(slab) == CMSuperslab);
       set(slab, static_cast<size_t>(CMNotOurs));
+      SlabmapProvider::pagemap().set_range(address_cast(slab), 0, SLAB_COUNT);
+    }
+    /**
+     * Record in the slab map that the small slab `slab` is owned by `alloc`,
+     * and holds objects of `sizeclass`.
+     */
+    static void
+    set_slab_owner(Slab* slab, RemoteAllocator* alloc, sizeclass_t sizeclass)
+    {
+      SNMALLOC_ASSERT(sizeclass < NUM_SMALL_CLASSES);
+      SlabmapProvider::pagemap().set(
+        address_cast(slab), address_cast(alloc) | sizeclass);
+    }
+    /**
+     * Get the slab map entry for the slab containing `p`, which is zero if
+     * it is not known to be a small slab.
+     */
+    static uintptr_t get_slab_owner(address_t p)
+    {
+      return SlabmapProvider::pagemap().get(p);
+    }
+    /**
+     * The allocator that owns a slab, from its slab map entry.
+     */
+    static RemoteAllocator* slab_owner_allocator(uintptr_t entry)
+    {
+      return pointer_cast<RemoteAllocator>(entry & ~SLABMAP_SIZECLASS_MASK);
+    }
+    /**
+     * The size class of the objects in a slab, from its slab map entry.
+     */
+    static sizeclass_t slab_owner_sizeclass(uintptr_t entry)
+    {
+      return entry & SLABMAP_SIZECLASS_MASK;
     }
     /**
      * Remove an entry corresponding to a medium slab.
@@ -196,17 +262,19 @@ namespace snmalloc
     }
     /**
      * Update the pagemap to reflect a large allocation, of `size` bytes from
-     * address `p`.
+     * address `p`, rounded up to a whole number of superslabs.
      */
     static void set_large_size(void* p, size_t size)
     {
       size_t size_bits = bits::next_pow2_bits(size);
+      size_t count = bits::align_up(size, SUPERSLAB_SIZE) >> SUPERSLAB_BITS;
       set(p, static_cast<uint8_t>(size_bits));
       // Set redirect slide
       auto ss = address_cast(p) + SUPERSLAB_SIZE;
       for (size_t i = 0; i < size_bits - SUPERSLAB_BITS; i++)
       {
-        size_t run = 1ULL << i;
+        size_t run = bits::one_at_bit(i);
+        run = bits::min(run, count - run);
         PagemapProvider::pagemap().set_range(
           ss, static_cast<uint8_t>(64 + i + SUPERSLAB_BITS), run);
         ss = ss + SUPERSLAB_SIZE * run;
@@ -219,11 +287,36 @@ namespace snmalloc
     static void clear_large_size(void* vp, size_t size)
     {
       auto p = address_cast(vp);
-      size_t rounded_size = bits::next_pow2(size);
       SNMALLOC_ASSERT(get(p) == bits::next_pow2_bits(size));
-      auto count = rounded_size >> SUPERSLAB_BITS;
+      auto count = bits::align_up(size, SUPERSLAB_SIZE) >> SUPERSLAB_BITS;
       PagemapProvider::pagemap().set_range(p, CMNotOurs, count);
     }
+    /**
+     * Return the size of the large allocation at `p`, whose pagemap entry
+     * is `size_bits`.  Its last superslab is in the second half of the
+     * power of two, which ends with the last redirection to `p`.  Whatever
+     * follows that cannot be a redirection by as much, so this can binary
+     * search for it.
+     */
+    static size_t get_large_size(address_t p, uint8_t size_bits)
+    {
+      size_t last_run = size_bits - SUPERSLAB_BITS;
+      if (last_run == 0)
+        return SUPERSLAB_SIZE;
+
+      auto redirect = static_cast<uint8_t>(63 + size_bits);
+      size_t lo = bits::one_at_bit(last_run - 1);
+      size_t hi = bits::one_at_bit(last_run);
+      while (hi - lo > 1)
+      {
+        size_t mid = lo + ((hi - lo) / 2);
+        if (get(p + (mid << SUPERSLAB_BITS)) == redirect)
+          lo = mid;
+        else
+          hi = mid;
+      }
+      return (lo + 1) << SUPERSLAB_BITS;
+    }
 
   private:
     /**
@@ -56,6 +56,9 @@ namespace snmalloc
 
     void release(Alloc* a)
     {
+      // Free chunks cached by an allocator that is not in use would
+      // otherwise stay out of reach of every other allocator.
+      a->flush_large_cache();
       Parent::release(a);
     }
 
@@ -95,22 +98,26 @@ namespace snmalloc
 #ifndef USE_MALLOC
       // Call this periodically to free and coalesce memory allocated by
       // allocators that are not currently in use by any thread.
-      // One atomic operation to extract the stack, another to restore it.
-      // Handling the message queue for each stack is non-atomic.
-      auto* first = Parent::extract();
-      auto* alloc = first;
-      decltype(alloc) last;
-
-      if (alloc != nullptr)
+      // One atomic operation to extract each node's stack, another to
+      // restore it.  Handling the message queue for each stack is non-atomic.
+      for (size_t node = 0; node < NUMA_NODES; node++)
       {
-        while (alloc != nullptr)
+        auto* first = Parent::extract(nullptr, node);
+        auto* alloc = first;
+        decltype(alloc) last;
+
+        if (alloc != nullptr)
         {
-          alloc->handle_message_queue();
-          last = alloc;
-          alloc = Parent::extract(alloc);
-        }
+          while (alloc != nullptr)
+          {
+            alloc->handle_message_queue();
+            alloc->flush_large_cache();
+            last = alloc;
+            alloc = Parent::extract(alloc);
+          }
 
-        restore(first, last);
+          restore(first, last, node);
+        }
       }
 #endif
     }
@@ -143,10 +150,9 @@ namespace snmalloc
 
           // Post all remotes, including forwarded ones. If any allocator posts,
           // repeat the loop.
-          if (alloc->remote.capacity < REMOTE_CACHE)
+          if (alloc->remote.capacity < alloc->remote.cache_size)
           {
-            alloc->stats().remote_post();
-            alloc->remote.post(alloc->id());
+            alloc->remote.post(alloc->id(), alloc->stats());
             done = false;
           }
 
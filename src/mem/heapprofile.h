@@ -0,0 +1,404 @@
+#pragma once
+
+#include "../ds/address.h"
+#include "../ds/flaglock.h"
+#include "../pal/pal.h"
+#include "allocconfig.h"
+
+#include <cmath>
+
+namespace snmalloc
+{
+  /**
+   * A sampled allocation.  The weight is the number of bytes of allocation
+   * that this sample stands for.
+   */
+  struct HeapSample
+  {
+    void* p;
+    size_t size;
+    size_t weight;
+    size_t depth;
+    void* frames[HEAP_PROFILE_DEPTH];
+  };
+
+  /**
+   * The live heap profile samples of all allocators.
+   *
+   * Samples are kept in an open addressing hash table keyed by address, so
+   * that freeing a sampled object can retire its sample.  The table is
+   * reserved from the memory provider the first time a sample is recorded.
+   */
+  class HeapProfile
+  {
+  private:
+    static constexpr size_t MASK = HEAP_PROFILE_SAMPLES - 1;
+
+    /**
+     * Stop adding samples at this many, so that probe sequences stay short.
+     */
+    static constexpr size_t MAX_LIVE = (HEAP_PROFILE_SAMPLES / 4) * 3;
+
+    std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    HeapSample* table = nullptr;
+
+    /**
+     * Number of live samples.  This is read without the lock to make
+     * freeing cheap when nothing is sampled.
+     */
+    std::atomic<size_t> live{0};
+
+    size_t total_objects = 0;
+    size_t total_bytes = 0;
+    size_t dropped = 0;
+
+    static size_t home(void* p)
+    {
+      uint64_t h = static_cast<uint64_t>(address_cast(p) >> MIN_ALLOC_BITS);
+      return static_cast<size_t>((h * 0x9E3779B97F4A7C15) >> 32) & MASK;
+    }
+
+    static size_t objects(size_t weight, size_t size)
+    {
+      return bits::max<size_t>(weight / size, 1);
+    }
+
+    size_t find(void* p)
+    {
+      size_t i = home(p);
+      while ((table[i].p != nullptr) && (table[i].p != p))
+        i = (i + 1) & MASK;
+      return i;
+    }
+
+    /**
+     * Remove the entry at `i`, moving back later entries in the same probe
+     * sequence so that no tombstones are needed.
+     */
+    void erase(size_t i)
+    {
+      size_t j = i;
+      while (true)
+      {
+        j = (j + 1) & MASK;
+        if (table[j].p == nullptr)
+          break;
+
+        // Leave entries whose home is cyclically in (i, j].
+        size_t k = home(table[j].p);
+        if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+          continue;
+
+        table[i] = table[j];
+        i = j;
+      }
+      table[i].p = nullptr;
+    }
+
+    template<typename MemoryProvider>
+    bool ensure_table(MemoryProvider& memory_provider)
+    {
+      if (table != nullptr)
+        return true;
+
+      size_t size = sizeof(HeapSample) * HEAP_PROFILE_SAMPLES;
+      size_t bits = bits::next_pow2_bits(size);
+      size_t large_class = bits > SUPERSLAB_BITS ? bits - SUPERSLAB_BITS : 0;
+      void* p = memory_provider.template reserve<true>(large_class);
+      if (p == nullptr)
+        return false;
+
+      table = static_cast<HeapSample*>(p);
+      for (size_t i = 0; i < HEAP_PROFILE_SAMPLES; i++)
+        table[i].p = nullptr;
+      return true;
+    }
+
+    /**
+     * Appends text to a caller supplied buffer, counting the length needed
+     * even once the buffer is full.
+     */
+    class Writer
+    {
+      char* buffer;
+      size_t length;
+      size_t used = 0;
+
+    public:
+      Writer(char* buffer, size_t length) : buffer(buffer), length(length) {}
+
+      void put(char c)
+      {
+        if (used < length)
+          buffer[used] = c;
+        used++;
+      }
+
+      void put(const char* s)
+      {
+        while (*s != '\0')
+          put(*s++);
+      }
+
+      void put(size_t value, size_t base = 10)
+      {
+        char digits[24];
+        size_t n = 0;
+        do
+        {
+          digits[n++] = "0123456789abcdef"[value % base];
+          value /= base;
+        } while (value != 0);
+
+        while (n > 0)
+          put(digits[--n]);
+      }
+
+      void put_counts(size_t objects, size_t bytes)
+      {
+        put(objects);
+        put(": ");
+        put(bytes);
+      }
+
+      size_t finish()
+      {
+        // Terminate, but do not count the terminator, as snprintf does.
+        if (length > 0)
+          buffer[used < length ? used : length - 1] = '\0';
+        return used;
+      }
+    };
+
+  public:
+    static HeapProfile& get()
+    {
+      static HeapProfile profile;
+      return profile;
+    }
+
+    /**
+     * Record a sample for `p`.  If the table is full the sample still counts
+     * towards the totals, but it is not kept.
+     */
+    template<typename MemoryProvider>
+    void record(
+      void* p,
+      size_t size,
+      size_t weight,
+      void** frames,
+      size_t depth,
+      MemoryProvider& memory_provider)
+    {
+      FlagLock f(lock);
+
+      total_objects += objects(weight, size);
+      total_bytes += weight;
+
+      if (
+        (live.load(std::memory_order_relaxed) >= MAX_LIVE) ||
+        !ensure_table(memory_provider))
+      {
+        dropped++;
+        return;
+      }
+
+      // A previous sample at this address may not have been retired if it
+      // was freed by another allocator implementation, so replace it.
+      HeapSample& s = table[find(p)];
+      if (s.p == nullptr)
+        live.fetch_add(1, std::memory_order_relaxed);
+
+      s.p = p;
+      s.size = size;
+      s.weight = weight;
+      s.depth = depth;
+      for (size_t i = 0; i < depth; i++)
+        s.frames[i] = frames[i];
+    }
+
+    /**
+     * Called as `p` is freed.  This is cheap unless there are live samples.
+     */
+    SNMALLOC_FAST_PATH void retire(void* p)
+    {
+      if (likely(live.load(std::memory_order_relaxed) == 0))
+        return;
+
+      retire_slow(p);
+    }
+
+    SNMALLOC_SLOW_PATH void retire_slow(void* p)
+    {
+      if ((p == nullptr) || (table == nullptr))
+        return;
+
+      FlagLock f(lock);
+      size_t i = find(p);
+      if (table[i].p == nullptr)
+        return;
+
+      erase(i);
+      live.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Write the live samples into `buffer` in the legacy text format that
+     * pprof reads, with counts already scaled to estimate the whole heap.
+     * Returns the length of the profile, which may be more than `length` if
+     * the buffer is too small.  Symbolising the profile also needs the
+     * process's mappings, which the caller can append.
+     */
+    size_t dump(char* buffer, size_t length)
+    {
+      FlagLock f(lock);
+      Writer w(buffer, length);
+
+      size_t live_objects = 0;
+      size_t live_bytes = 0;
+      for (size_t i = 0; (table != nullptr) && (i < HEAP_PROFILE_SAMPLES); i++)
+      {
+        if (table[i].p == nullptr)
+          continue;
+        live_objects += objects(table[i].weight, table[i].size);
+        live_bytes += table[i].weight;
+      }
+
+      w.put("heap profile: ");
+      w.put_counts(live_objects, live_bytes);
+      w.put(" [");
+      w.put_counts(total_objects, total_bytes);
+      w.put("] @ heap\n");
+
+      for (size_t i = 0; (table != nullptr) && (i < HEAP_PROFILE_SAMPLES); i++)
+      {
+        HeapSample& s = table[i];
+        if (s.p == nullptr)
+          continue;
+
+        size_t n = objects(s.weight, s.size);
+        w.put_counts(n, s.weight);
+        w.put(" [");
+        w.put_counts(n, s.weight);
+        w.put("] @");
+        for (size_t d = 0; d < s.depth; d++)
+        {
+          w.put(" 0x");
+          w.put(static_cast<size_t>(address_cast(s.frames[d])), 16);
+        }
+        w.put('\n');
+      }
+
+      return w.finish();
+    }
+
+    /**
+     * Number of samples not kept because the table was full.
+     */
+    size_t dropped_samples()
+    {
+      FlagLock f(lock);
+      return dropped;
+    }
+  };
+
+  /**
+   * Per-allocator state for sampling allocations.
+   *
+   * Sampling is a Poisson process over bytes allocated: the gap between
+   * samples is drawn from an exponential distribution with a mean of
+   * `HEAP_PROFILE_INTERVAL`.  Only slow paths count bytes, charging the
+   * whole of a new free list when it is taken, so the object that triggers
+   * a sample stands for every byte in the interval.  This does nothing
+   * unless built with `SNMALLOC_HEAP_PROFILE`.
+   */
+  class HeapProfiler
+  {
+#ifdef SNMALLOC_HEAP_PROFILE
+    size_t countdown = HEAP_PROFILE_INTERVAL;
+    uint64_t rng = 0;
+
+    /**
+     * Set while capturing a sample, as capturing a backtrace may allocate.
+     */
+    bool sampling = false;
+
+    size_t next_interval()
+    {
+      if (rng == 0)
+        rng = (address_cast(this) | 1) * 0x9E3779B97F4A7C15;
+
+      // xorshift64
+      rng ^= rng << 13;
+      rng ^= rng >> 7;
+      rng ^= rng << 17;
+
+      // Uniform in (0, 1], using the top 53 bits.
+      double u = static_cast<double>((rng >> 11) + 1) * 0x1.0p-53;
+      double gap = -std::log(u) * static_cast<double>(HEAP_PROFILE_INTERVAL);
+      return static_cast<size_t>(gap) + 1;
+    }
+
+    template<typename MemoryProvider>
+    SNMALLOC_SLOW_PATH void
+    sample(void* p, size_t bytes, size_t size, MemoryProvider& memory_provider)
+    {
+      size_t weight = 0;
+      while (bytes >= countdown)
+      {
+        bytes -= countdown;
+        weight += HEAP_PROFILE_INTERVAL;
+        countdown = next_interval();
+      }
+      countdown -= bytes;
+
+      if (sampling)
+        return;
+      sampling = true;
+
+      void* frames[HEAP_PROFILE_DEPTH];
+      size_t depth = 0;
+      if constexpr (pal_supports<Backtrace>)
+        depth = Pal::capture_backtrace(frames, HEAP_PROFILE_DEPTH);
+
+      HeapProfile::get().record(
+        p, size, weight, frames, depth, memory_provider);
+      sampling = false;
+    }
+#endif
+
+  public:
+    /**
+     * Account for `bytes` being made available to allocate, as `p` of
+     * `size` bytes is allocated.  Returns `p`.
+     */
+    template<typename MemoryProvider>
+    SNMALLOC_FAST_PATH void* alloc(
+      void* p, size_t bytes, size_t size, MemoryProvider& memory_provider)
+    {
+#ifdef SNMALLOC_HEAP_PROFILE
+      if (likely(bytes < countdown))
+        countdown -= bytes;
+      else if (p != nullptr)
+        sample(p, bytes, size, memory_provider);
+#else
+      UNUSED(bytes);
+      UNUSED(size);
+      UNUSED(memory_provider);
+#endif
+      return p;
+    }
+
+    /**
+     * Called as `p` is freed.
+     */
+    static SNMALLOC_FAST_PATH void dealloc(void* p)
+    {
+#ifdef SNMALLOC_HEAP_PROFILE
+      HeapProfile::get().retire(p);
+#else
+      UNUSED(p);
+#endif
+    }
+  };
+} // namespace snmalloc
@@ -1,8 +1,8 @@
 #pragma once
 
+#include "../ds/eliminationstack.h"
 #include "../ds/flaglock.h"
 #include "../ds/helpers.h"
-#include "../ds/mpmcstack.h"
 #include "../pal/pal.h"
 #include "allocstats.h"
 #include "baseslab.h"
@@ -16,17 +16,28 @@ namespace snmalloc
   template<class PAL>
   class MemoryProviderStateMixin;
 
+  template<class MemoryProvider>
+  class LargeAlloc;
+
   class Largeslab : public Baseslab
   {
     // This is the view of a contiguous memory area when it is being kept
     // in the global size-classed caches of available contiguous memory areas.
   private:
     template<class a, Construction c>
-    friend class MPMCStack;
+    friend class EliminationStack;
     template<class PAL>
     friend class MemoryProviderStateMixin;
+    template<class MemoryProvider>
+    friend class LargeAlloc;
     std::atomic<Largeslab*> next;
 
+    /**
+     * Time at which this chunk was returned to the large stack.  Only
+     * maintained by the `DecommitSuperDecay` strategy.
+     */
+    uint64_t last_used;
+
   public:
     void init()
     {
@@ -41,12 +52,18 @@ namespace snmalloc
    */
   struct Decommittedslab : public Largeslab
   {
+    /**
+     * Whether every page after the first is known to read as zero, because
+     * it is fresh or was released with `notify_not_using_now`.
+     */
+    bool zeroed;
+
     /**
      * Constructor.  Expected to be called via placement new into some memory
      * that was formerly a superslab or large allocation and is now just some
      * spare address space.
      */
-    Decommittedslab()
+    Decommittedslab(bool zeroed = false) : zeroed(zeroed)
     {
       kind = Decommitted;
     }
@@ -79,11 +96,55 @@ namespace snmalloc
      */
     std::atomic_flag lazy_decommit_guard = {};
 
+    /**
+     * Time after which the next scan for decayed chunks is due.
+     */
+    std::atomic<uint64_t> next_decay_scan{0};
+
+    /**
+     * Bytes of address space reserved from the platform.
+     */
+    std::atomic<size_t> reserved_bytes{0};
+
+    /**
+     * Bytes of chunks in the large stacks that will be recommitted when they
+     * are reused, see `is_decommitted`.
+     */
+    std::atomic<size_t> retained_bytes{0};
+
+    /**
+     * Flag to serialise merging free chunks, see `coalesce`.
+     */
+    std::atomic_flag coalesce_lock = ATOMIC_FLAG_INIT;
+
+    /**
+     * Whether chunks have been returned to each node's large stacks since
+     * they were last merged.
+     */
+    ModArray<NUMA_NODES, std::atomic<bool>> coalesce_pending{};
+
+    /**
+     * Incremented to ask every allocator to return its cache of free chunks
+     * to the large stacks, see `LargeAlloc::flush_cache`.
+     */
+    std::atomic<uint64_t> cache_flushes{0};
+
   public:
+    using LargeStacks =
+      ModArray<NUM_LARGE_CLASSES, EliminationStack<Largeslab, RequiresInit>>;
+
+    /**
+     * Stacks of large allocations that have been returned for reuse, indexed
+     * by NUMA node and then by large class.
+     */
+    ModArray<NUMA_NODES, LargeStacks> large_stack;
+
     /**
-     * Stack of large allocations that have been returned for reuse.
+     * Large classes below this value are hinted to be backed by huge pages
+     * when they are first carved out of reserved address space.  Has no
+     * effect if the PAL does not support `HugePages`.
      */
-    ModArray<NUM_LARGE_CLASSES, MPMCStack<Largeslab, RequiresInit>> large_stack;
+    size_t huge_page_classes = HUGE_PAGE_LARGE_CLASSES;
 
     /**
      * Make a new memory provide for this PAL.
@@ -120,7 +181,56 @@ namespace snmalloc
       return allocated;
     }
 
+    /**
+     * The NUMA node of the calling thread, used to select per-node free
+     * lists.  Always zero unless configured with more than one node on a PAL
+     * that can report it.
+     */
+    static size_t numa_node()
+    {
+      if constexpr ((NUMA_NODES > 1) && pal_supports<NumaLocality, PAL>)
+        return PAL::get_numa_node() & (NUMA_NODES - 1);
+      else
+        return 0;
+    }
+
   private:
+    /**
+     * Apply the huge page policy to a freshly reserved chunk of the given
+     * large class.  This is done once per chunk, so reuse from the
+     * `large_stack` does not pay for another system call.
+     */
+    void advise_chunk(void* p, size_t large_class)
+    {
+      if constexpr (pal_supports<HugePages, PAL>)
+      {
+        if (large_class < huge_page_classes)
+          PAL::advise_huge_pages(
+            p, bits::one_at_bit(SUPERSLAB_BITS) << large_class);
+      }
+      else
+      {
+        UNUSED(p);
+        UNUSED(large_class);
+      }
+    }
+
+    /**
+     * Prefer the given NUMA node for pages in a fresh reservation.  This must
+     * happen before the pages are first touched.
+     */
+    void bind_to_node(void* p, size_t size, size_t node)
+    {
+      if constexpr ((NUMA_NODES > 1) && pal_supports<NumaLocality, PAL>)
+        PAL::bind_numa_node(p, size, node);
+      else
+      {
+        UNUSED(p);
+        UNUSED(size);
+        UNUSED(node);
+      }
+    }
+
     void new_block()
     {
       // Reserve the smallest large_class which is SUPERSLAB_SIZE
@@ -151,6 +261,7 @@ namespace snmalloc
       // hit cached superslabs first.
       // FIXME: We probably shouldn't do this all at once.
       // FIXME: We currently Decommit all the sizeclasses larger than 0.
+      request_cache_flush();
       for (size_t large_class = 0; large_class < NUM_LARGE_CLASSES;
            large_class++)
       {
@@ -158,48 +269,310 @@ namespace snmalloc
         {
           break;
         }
-        size_t rsize = bits::one_at_bit(SUPERSLAB_BITS) << large_class;
-        size_t decommit_size = rsize - OS_PAGE_SIZE;
-        // Grab all of the chunks of this size class.
-        auto* slab = large_stack[large_class].pop_all();
-        while (slab)
+        for (size_t node = 0; node < NUMA_NODES; node++)
+          decommit_stack(node, large_class);
+      }
+      lazy_decommit_guard.clear();
+    }
+
+    /**
+     * Decommit every chunk in one of the large stacks, except for the first
+     * page of each, which holds the link.
+     */
+    void decommit_stack(size_t node, size_t large_class)
+    {
+      // Where untouched pages cost nothing, chunks that are adjacent in
+      // memory are released together, including the link pages between
+      // them, which are then written again.
+      constexpr bool coalesce = pal_supports<LazyCommit, PAL>;
+
+      size_t rsize = bits::one_at_bit(SUPERSLAB_BITS) << large_class;
+      auto& stack = large_stack[node][large_class];
+      // Grab all of the chunks of this size class.
+      auto* slab = stack.pop_all();
+      while (slab)
+      {
+        // Once we've removed these from the stack, there will be no
+        // concurrent accesses and removal should have established a
+        // happens-before relationship, so it's safe to use relaxed loads
+        // here.
+        Largeslab* start = slab;
+        bool release = slab->get_kind() != Decommitted;
+        bool zeroed = !release && static_cast<Decommittedslab*>(slab)->zeroed;
+        bool was_decommitted = is_decommitted(slab, large_class);
+        size_t count = 0;
+        do
         {
-          // Decommit all except for the first page and then put it back on
-          // the stack.
-          if (slab->get_kind() != Decommitted)
-          {
-            PAL::notify_not_using(
-              pointer_offset(slab, OS_PAGE_SIZE), decommit_size);
-          }
-          // Once we've removed these from the stack, there will be no
-          // concurrent accesses and removal should have established a
-          // happens-before relationship, so it's safe to use relaxed loads
-          // here.
-          auto next = slab->next.load(std::memory_order_relaxed);
-          large_stack[large_class].push(new (slab) Decommittedslab());
-          slab = next;
+          count++;
+          slab = slab->next.load(std::memory_order_relaxed);
+        } while (coalesce && release && (slab != nullptr) &&
+                 (slab == pointer_offset(start, count * rsize)) &&
+                 (slab->get_kind() != Decommitted));
+
+        // Decommit all except for the first page and then put them back on
+        // the stack.
+        if (release)
+        {
+          size_t size = (count * rsize) - OS_PAGE_SIZE;
+          zeroed = release_now(pointer_offset(start, OS_PAGE_SIZE), size);
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+          void* chunk = pointer_offset(start, i * rsize);
+          if (i > 0)
+            PAL::template notify_using<NoZero>(chunk, OS_PAGE_SIZE);
+          auto d = new (chunk) Decommittedslab(zeroed);
+          if (!was_decommitted && is_decommitted(d, large_class))
+            retained_bytes.fetch_add(rsize, std::memory_order_relaxed);
+          stack.push(d);
         }
       }
-      lazy_decommit_guard.clear();
     }
 
-    void push_space(address_t start, size_t large_class)
+    void push_space(address_t start, size_t large_class, size_t node)
     {
       // All fresh pages so can use "NoZero"
       void* p = pointer_cast<void>(start);
-      if (large_class > 0)
+      advise_chunk(p, large_class);
+      if (
+        (decommit_strategy == DecommitSuperLazy) ||
+        (decommit_strategy == DecommitSuperDecay))
+      {
+        // These strategies inspect the kind of every chunk on the stack, so
+        // mark fresh space as not yet committed.
+        PAL::template notify_using<NoZero>(p, OS_PAGE_SIZE);
+        p = new (p) Decommittedslab(pal_supports<LazyRelease, PAL>);
+      }
+      else if (large_class > 0)
         PAL::template notify_using<NoZero>(p, OS_PAGE_SIZE);
       else
+        PAL::template notify_using<NoZero>(p, SUPERSLAB_SIZE);
+      push_large(p, large_class, node);
+    }
+
+    /**
+     * Push a chunk onto the large stack for the given node, counting it as
+     * retained if it will be recommitted when it is reused.
+     */
+    void push_chunk(void* p, size_t large_class, size_t node)
+    {
+      count_retained(p, large_class);
+      large_stack[node][large_class].push(static_cast<Largeslab*>(p));
+    }
+
+    /**
+     * Sort a list of chunks by address.
+     */
+    static Largeslab* sort_by_address(Largeslab* list)
+    {
+      if (list == nullptr)
+        return nullptr;
+
+      // Split the list in two halves.
+      Largeslab* slow = list;
+      Largeslab* fast = list->next.load(std::memory_order_relaxed);
+      if (fast == nullptr)
+        return list;
+      while (fast != nullptr)
+      {
+        fast = fast->next.load(std::memory_order_relaxed);
+        if (fast == nullptr)
+          break;
+        fast = fast->next.load(std::memory_order_relaxed);
+        slow = slow->next.load(std::memory_order_relaxed);
+      }
+      Largeslab* second = slow->next.load(std::memory_order_relaxed);
+      slow->next.store(nullptr, std::memory_order_relaxed);
+
+      Largeslab* a = sort_by_address(list);
+      Largeslab* b = sort_by_address(second);
+
+      // Merge the sorted halves.
+      Largeslab* head = nullptr;
+      std::atomic<Largeslab*>* tail = nullptr;
+      while ((a != nullptr) || (b != nullptr))
       {
-        if (decommit_strategy == DecommitSuperLazy)
+        Largeslab* take;
+        if (
+          (b == nullptr) ||
+          ((a != nullptr) && (address_cast(a) < address_cast(b))))
+        {
+          take = a;
+          a = a->next.load(std::memory_order_relaxed);
+        }
+        else
         {
-          PAL::template notify_using<NoZero>(p, OS_PAGE_SIZE);
-          p = new (p) Decommittedslab();
+          take = b;
+          b = b->next.load(std::memory_order_relaxed);
         }
+
+        if (tail == nullptr)
+          head = take;
         else
-          PAL::template notify_using<NoZero>(p, SUPERSLAB_SIZE);
+          tail->store(take, std::memory_order_relaxed);
+        tail = &take->next;
+      }
+      tail->store(nullptr, std::memory_order_relaxed);
+      return head;
+    }
+
+    /**
+     * The release of all but the first page of a chunk, deferred by
+     * `merge_buddies`.  The record is kept at the end of that first page,
+     * which stays committed and is not otherwise used by a free chunk.
+     */
+    struct PendingRelease
+    {
+      PendingRelease* next;
+      size_t size;
+
+      static PendingRelease* of(void* chunk)
+      {
+        return static_cast<PendingRelease*>(
+          pointer_offset(chunk, OS_PAGE_SIZE - sizeof(PendingRelease)));
+      }
+
+      void* pages()
+      {
+        return pointer_offset(this, sizeof(PendingRelease));
+      }
+    };
+
+    /**
+     * Merge the free chunk `b` of the given large class into its buddy `a`,
+     * the chunk that precedes it, leaving `a` as a chunk of the next class.
+     * A merged chunk is only marked as decommitted if all of it may be, so
+     * the committed half of a mixed pair must be released.  That is added to
+     * `pending`, for `release_pending` once the large stacks are restored.
+     */
+    void merge_buddies(
+      Largeslab* a, Largeslab* b, size_t large_class, PendingRelease*& pending)
+    {
+      size_t rsize = bits::one_at_bit(SUPERSLAB_BITS) << large_class;
+      bool a_decommitted = a->get_kind() == Decommitted;
+      bool b_decommitted = b->get_kind() == Decommitted;
+
+      if (!a_decommitted && !b_decommitted)
+      {
+        uint64_t last_used = 0;
+        if constexpr (decommit_strategy == DecommitSuperDecay)
+          last_used = bits::max(a->last_used, b->last_used);
+        a->init();
+        a->last_used = last_used;
+        return;
+      }
+
+      // Everything after the link in each half is released.  The first page
+      // of `b` stays committed, as a stale `pop` may still read its link.
+      constexpr bool release_zeroes = pal_supports<LazyRelease, PAL>;
+      bool zeroed = a_decommitted ?
+        static_cast<Decommittedslab*>(a)->zeroed :
+        release_zeroes;
+      zeroed = zeroed &&
+        (b_decommitted ? static_cast<Decommittedslab*>(b)->zeroed :
+                         release_zeroes);
+
+      if (zeroed)
+        PAL::template zero<false>(b, OS_PAGE_SIZE);
+
+      for (Largeslab* half : {a, b})
+      {
+        if (half->get_kind() == Decommitted)
+          continue;
+        auto r = PendingRelease::of(half);
+        r->next = pending;
+        r->size = rsize - OS_PAGE_SIZE;
+        pending = r;
+      }
+
+      new (a) Decommittedslab(zeroed);
+    }
+
+    /**
+     * Release the pages deferred by `merge_buddies`, clearing each record so
+     * that a merged chunk that reads as zero does so in full.
+     */
+    void release_pending(PendingRelease* pending)
+    {
+      while (pending != nullptr)
+      {
+        PendingRelease* next = pending->next;
+        release_now(pending->pages(), pending->size);
+        pending->next = nullptr;
+        pending->size = 0;
+        pending = next;
+      }
+    }
+
+    /**
+     * Merge the chunks in the large stacks of the given node whose buddy,
+     * the other half of the chunk of the next class up, is also free.  This
+     * is only done when a request would otherwise reserve more address
+     * space, and chunks have been freed since the last time.  Each stack is
+     * empty only while its chunks are sorted and paired up, and the pages
+     * that merging releases are released after it has been refilled.
+     */
+    void coalesce(size_t node)
+    {
+      if constexpr (pal_supports<MergeableReservations, PAL>)
+      {
+        FlagLock f(coalesce_lock);
+        if (!coalesce_pending[node].exchange(false, std::memory_order_relaxed))
+          return;
+
+        // Chunks merged into the class being visited.
+        Largeslab* merged = nullptr;
+        for (size_t large_class = 0; large_class < NUM_LARGE_CLASSES;
+             large_class++)
+        {
+          size_t rsize = bits::one_at_bit(SUPERSLAB_BITS) << large_class;
+          Largeslab* slab = large_stack[node][large_class].pop_all();
+
+          // Nothing else can reach these chunks until they are pushed back
+          // below, which counts them as retained again.
+          while (slab != nullptr)
+          {
+            auto next = slab->next.load(std::memory_order_relaxed);
+            take_retained(slab, large_class);
+            slab->next.store(merged, std::memory_order_relaxed);
+            merged = slab;
+            slab = next;
+          }
+
+          slab = sort_by_address(merged);
+          merged = nullptr;
+          PendingRelease* pending = nullptr;
+          while (slab != nullptr)
+          {
+            auto next = slab->next.load(std::memory_order_relaxed);
+            if (
+              (large_class + 1 < NUM_LARGE_CLASSES) &&
+              (next == pointer_offset(slab, rsize)) &&
+              (pointer_align_up(slab, rsize * 2) == slab))
+            {
+              Largeslab* after = next->next.load(std::memory_order_relaxed);
+              merge_buddies(slab, next, large_class, pending);
+              slab->next.store(merged, std::memory_order_relaxed);
+              merged = slab;
+              slab = after;
+            }
+            else
+            {
+              push_chunk(slab, large_class, node);
+              slab = next;
+            }
+          }
+
+          // The merged chunks are not pushed until the next class is
+          // visited, after this.
+          release_pending(pending);
+        }
+      }
+      else
+      {
+        UNUSED(node);
       }
-      large_stack[large_class].push(reinterpret_cast<Largeslab*>(p));
     }
 
     /***
@@ -213,6 +586,350 @@ namespace snmalloc
     }
 
   public:
+    /**
+     * Release pages that are not expected to be reused soon, so that they
+     * stop counting against the process now rather than when the platform
+     * runs short of memory.  Returns whether they will read as zero.
+     */
+    bool release_now(void* p, size_t size)
+    {
+      if constexpr (pal_supports<LazyRelease, PAL>)
+      {
+        PAL::notify_not_using_now(p, size);
+        return true;
+      }
+      else
+      {
+        PAL::notify_not_using(p, size);
+        return false;
+      }
+    }
+
+    /**
+     * Whether a chunk in the large stack is treated as decommitted, so that
+     * `LargeAlloc::alloc` recommits it when it is reused.
+     */
+    static bool is_decommitted(void* p, size_t large_class)
+    {
+      // Cross-reference alloc.h's large_dealloc decommitment condition.
+      return (((decommit_strategy == DecommitSuperLazy) ||
+               (decommit_strategy == DecommitSuperDecay)) &&
+              (static_cast<Baseslab*>(p)->get_kind() == Decommitted)) ||
+        ((large_class > 0) && (decommit_strategy != DecommitSuperDecay)) ||
+        (decommit_strategy == DecommitSuper);
+    }
+
+    /**
+     * Called on a chunk that has just been freed, before it is put in a
+     * large stack or an allocator's cache of chunks.  Counts it as retained
+     * if it will be recommitted when it is reused.
+     */
+    void count_retained(void* p, size_t large_class)
+    {
+      if (is_decommitted(p, large_class))
+      {
+        retained_bytes.fetch_add(
+          bits::one_at_bit(SUPERSLAB_BITS) << large_class,
+          std::memory_order_relaxed);
+      }
+    }
+
+    /**
+     * Return a chunk to the large stack for the given node.
+     */
+    void push_large(void* p, size_t large_class, size_t node)
+    {
+      auto& pending = coalesce_pending[node];
+      if (!pending.load(std::memory_order_relaxed))
+        pending.store(true, std::memory_order_relaxed);
+      push_chunk(p, large_class, node);
+    }
+
+    /**
+     * Return a list of chunks, already passed to `count_retained`, to the
+     * large stack for the given node with a single push.
+     */
+    void push_large_list(
+      Largeslab* first, Largeslab* last, size_t large_class, size_t node)
+    {
+      auto& pending = coalesce_pending[node];
+      if (!pending.load(std::memory_order_relaxed))
+        pending.store(true, std::memory_order_relaxed);
+      large_stack[node][large_class].push(first, last);
+    }
+
+    /**
+     * Take a free chunk of at least the given large class from the large
+     * stacks of the given node, and set `chunk_class` to its class.  A chunk
+     * of the exact class is taken without locking if there is one.  Failing
+     * that, a larger chunk is taken for the caller to split, after merging
+     * the free chunks if there is none.
+     */
+    Largeslab* pop_large(size_t large_class, size_t node, size_t& chunk_class)
+    {
+      Largeslab* p = large_stack[node][large_class].pop();
+      if (likely(p != nullptr))
+      {
+        chunk_class = large_class;
+        return p;
+      }
+      return pop_larger(large_class, node, chunk_class);
+    }
+
+    /**
+     * Slow path for `pop_large`.
+     */
+    SNMALLOC_SLOW_PATH Largeslab*
+    pop_larger(size_t large_class, size_t node, size_t& chunk_class)
+    {
+      for (size_t c = large_class + 1; c < NUM_LARGE_CLASSES; c++)
+      {
+        Largeslab* p = large_stack[node][c].pop();
+        if (p != nullptr)
+        {
+          chunk_class = c;
+          return p;
+        }
+      }
+
+      coalesce(node);
+
+      for (size_t c = large_class; c < NUM_LARGE_CLASSES; c++)
+      {
+        Largeslab* p = large_stack[node][c].pop();
+        if (p != nullptr)
+        {
+          chunk_class = c;
+          return p;
+        }
+      }
+      return nullptr;
+    }
+
+    /**
+     * Called on a chunk just taken from the large stack.  Returns whether it
+     * needs to be recommitted, and if so stops counting it as retained.
+     */
+    bool take_retained(void* p, size_t large_class)
+    {
+      if (!is_decommitted(p, large_class))
+        return false;
+
+      retained_bytes.fetch_sub(
+        bits::one_at_bit(SUPERSLAB_BITS) << large_class,
+        std::memory_order_relaxed);
+      return true;
+    }
+
+    /**
+     * Remove the first chunk of the given large class that satisfies
+     * `match` from the large stacks, starting with this thread's node.
+     * Chunks are popped one at a time, and only the top `search_depth` of
+     * each stack are examined, so concurrent requests still find the rest
+     * of the stack while this runs.
+     */
+    template<typename F>
+    Largeslab* take_matching(size_t large_class, F match)
+    {
+      // Recently freed chunks, which are the most likely to match, are on
+      // top of the stacks.
+      constexpr size_t search_depth = 16;
+
+      size_t home = numa_node();
+      for (size_t n = 0; n < NUMA_NODES; n++)
+      {
+        auto& stack = large_stack[(home + n) % NUMA_NODES][large_class];
+        Largeslab* first = nullptr;
+        Largeslab* last = nullptr;
+        Largeslab* found = nullptr;
+
+        // Nothing else can reach the popped chunks until the ones that do not
+        // match are pushed back as a single list below.
+        for (size_t i = 0; i < search_depth; i++)
+        {
+          Largeslab* slab = stack.pop();
+          if (slab == nullptr)
+            break;
+          if (match(slab))
+          {
+            found = slab;
+            break;
+          }
+          if (last == nullptr)
+            first = slab;
+          else
+            last->next.store(slab, std::memory_order_relaxed);
+          last = slab;
+        }
+
+        if (first != nullptr)
+          stack.push(first, last);
+
+        if (found != nullptr)
+          return found;
+      }
+      return nullptr;
+    }
+
+    /**
+     * Remove the chunk `p` of the given large class from the large stacks,
+     * if it is there.  On success, `decommitted` says whether the chunk
+     * needs to be recommitted, as for `take_retained`.
+     */
+    bool take_chunk(void* p, size_t large_class, bool& decommitted)
+    {
+      if (take_matching(large_class, [p](void* slab) { return slab == p; }) ==
+          nullptr)
+        return false;
+
+      decommitted = take_retained(p, large_class);
+      return true;
+    }
+
+    /**
+     * Bytes of address space reserved from the platform.
+     */
+    size_t reserved()
+    {
+      return reserved_bytes.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Bytes of reserved address space that are in the large stacks and not
+     * committed.
+     */
+    size_t retained()
+    {
+      return retained_bytes.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Decommit all unused chunks in the large stacks now, rather than waiting
+     * for low memory or for them to decay.
+     */
+    void decommit_all()
+    {
+      request_cache_flush();
+      for (size_t node = 0; node < NUMA_NODES; node++)
+      {
+        for (size_t large_class = 0; large_class < NUM_LARGE_CLASSES;
+             large_class++)
+          decommit_stack(node, large_class);
+      }
+    }
+
+    /**
+     * Ask every allocator to return its cache of free chunks to the large
+     * stacks the next time it frees or allocates a chunk.  Caches are owned
+     * by their allocators, so they cannot be emptied from here.
+     */
+    void request_cache_flush()
+    {
+      cache_flushes.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * The number of times `request_cache_flush` has been called.
+     */
+    uint64_t cache_flush_requests()
+    {
+      return cache_flushes.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Return a chunk that is still committed to the large stack, recording
+     * when it was last used so that it can be decommitted once it has been
+     * idle for `DECOMMIT_DECAY_MS`.
+     */
+    void push_decaying(void* p, size_t large_class, size_t node)
+    {
+      auto slab = static_cast<Largeslab*>(p);
+      slab->init();
+      slab->last_used = PAL::time_in_ms();
+      push_large(slab, large_class, node);
+    }
+
+    /**
+     * Scan for decayed chunks if enough time has passed since the last scan.
+     * This is cheap enough to be called from the large allocation slow path.
+     * At most one caller per interval performs the scan.
+     */
+    void decay_tick()
+    {
+      uint64_t now = PAL::time_in_ms();
+      uint64_t due = next_decay_scan.load(std::memory_order_relaxed);
+      if (likely(now < due))
+        return;
+
+      if (!next_decay_scan.compare_exchange_strong(
+            due, now + (DECOMMIT_DECAY_MS / 2), std::memory_order_relaxed))
+        return;
+
+      decommit_decayed(now);
+    }
+
+    /**
+     * Decommit all chunks in the large stack that have been unused for at
+     * least `DECOMMIT_DECAY_MS` as of `now`.  Applications that prefer not to
+     * pay for this on the allocation path can call this periodically from a
+     * dedicated purge thread.
+     */
+    void decommit_decayed(uint64_t now)
+    {
+      for (size_t i = 0; i < NUM_LARGE_CLASSES * NUMA_NODES; i++)
+      {
+        size_t large_class = i % NUM_LARGE_CLASSES;
+        auto& stack = large_stack[i / NUM_LARGE_CLASSES][large_class];
+        size_t rsize = bits::one_at_bit(SUPERSLAB_BITS) << large_class;
+        auto* slab = stack.pop_all();
+        if (slab == nullptr)
+          continue;
+
+        // Split the chunks into those to decommit and the rest, and push the
+        // rest back before making any system calls, so that other threads
+        // are only without the chunks that are being decommitted.
+        Largeslab* keep_first = nullptr;
+        Largeslab* keep_last = nullptr;
+        Largeslab* decay_first = nullptr;
+        Largeslab* decay_last = nullptr;
+        while (slab != nullptr)
+        {
+          auto next = slab->next.load(std::memory_order_relaxed);
+          bool decayed = (slab->get_kind() != Decommitted) &&
+            (now >= slab->last_used + DECOMMIT_DECAY_MS);
+          Largeslab*& list_first = decayed ? decay_first : keep_first;
+          Largeslab*& list_last = decayed ? decay_last : keep_last;
+          if (list_last == nullptr)
+            list_first = slab;
+          else
+            list_last->next.store(slab, std::memory_order_relaxed);
+          list_last = slab;
+          slab = next;
+        }
+
+        if (keep_first != nullptr)
+          stack.push(keep_first, keep_last);
+
+        if (decay_first == nullptr)
+          continue;
+
+        decay_last->next.store(nullptr, std::memory_order_relaxed);
+        for (slab = decay_first; slab != nullptr;)
+        {
+          auto next = slab->next.load(std::memory_order_relaxed);
+
+          // Decommit all except for the first page, which holds the link.
+          bool zeroed = release_now(
+            pointer_offset(slab, OS_PAGE_SIZE), rsize - OS_PAGE_SIZE);
+          new (slab) Decommittedslab(zeroed);
+          slab->next.store(next, std::memory_order_relaxed);
+          retained_bytes.fetch_add(rsize, std::memory_order_relaxed);
+          slab = next;
+        }
+        stack.push(decay_first, decay_last);
+      }
+    }
+
     /**
      * Primitive allocator for structure that are required before
      * the allocator can be running.
@@ -272,7 +989,14 @@ namespace snmalloc
 
       if constexpr (pal_supports<AlignedAllocation, PAL>)
       {
-        return PAL::template reserve<committed>(size, align);
+        void* result = PAL::template reserve<committed>(size, align);
+        if (result != nullptr)
+        {
+          reserved_bytes.fetch_add(size, std::memory_order_relaxed);
+          bind_to_node(result, size, numa_node());
+          advise_chunk(result, large_class);
+        }
+        return result;
       }
       else
       {
@@ -284,6 +1008,13 @@ namespace snmalloc
         if (p == nullptr)
           return nullptr;
 
+        reserved_bytes.fetch_add(request, std::memory_order_relaxed);
+
+        // The whole reservation, including the leftovers, belongs to the
+        // calling thread's node.
+        size_t node = numa_node();
+        bind_to_node(p, request, node);
+
         address_t p0 = address_cast(p);
         address_t start = bits::align_up(p0, align);
         address_t p1 = p0 + request;
@@ -291,7 +1022,7 @@ namespace snmalloc
 
         for (; end < bits::align_down(p1, align); end += size)
         {
-          push_space(end, large_class);
+          push_space(end, large_class, node);
         }
 
         // Put offcuts before alignment into the large stack
@@ -304,7 +1035,7 @@ namespace snmalloc
           offcut_start = bits::align_up(p0, offcut_align);
           if (offcut_start != offcut_end)
           {
-            push_space(offcut_start, i);
+            push_space(offcut_start, i, node);
             offcut_end = offcut_start;
           }
         }
@@ -318,18 +1049,87 @@ namespace snmalloc
           offcut_end = bits::align_down(p1, offcut_align);
           if (offcut_start != offcut_end)
           {
-            push_space(offcut_start, i);
+            push_space(offcut_start, i, node);
             offcut_start = offcut_end;
           }
         }
 
         void* result = pointer_cast<void>(start);
+        advise_chunk(result, large_class);
         if (committed)
           PAL::template notify_using<NoZero>(result, size);
 
         return result;
       }
     }
+
+    /**
+     * Reserve `size` bytes aligned to `align` directly from the platform, for
+     * a single large allocation that is returned with `unreserve`.
+     */
+    void* reserve_direct(size_t size, size_t align) noexcept
+    {
+      void* p;
+      if constexpr (pal_supports<AlignedAllocation, PAL>)
+      {
+        p = PAL::template reserve<false>(size, align);
+        if (p == nullptr)
+          return nullptr;
+      }
+      else
+      {
+        // Over-reserve and return the misaligned ends.
+        void* r = PAL::template reserve<false>(size + align);
+        if (r == nullptr)
+          return nullptr;
+
+        p = pointer_align_up(r, align);
+        size_t before = pointer_diff(r, p);
+        if (before != 0)
+          PAL::unreserve(r, before);
+        PAL::unreserve(pointer_offset(p, size), align - before);
+      }
+
+      reserved_bytes.fetch_add(size, std::memory_order_relaxed);
+      bind_to_node(p, size, numa_node());
+      return p;
+    }
+
+    /**
+     * Return memory from `reserve_direct` to the platform.
+     */
+    void unreserve(void* p, size_t size) noexcept
+    {
+      PAL::unreserve(p, size);
+      reserved_bytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    /**
+     * Move the pages backing `size` bytes at `src`, part of a large
+     * allocation of the given large class, over those at `dst`.  Where the
+     * platform had to map `src` again, the new mapping is given the advice
+     * and binding that a fresh chunk would get.  Direct allocations pass
+     * `NUM_LARGE_CLASSES`, as they are never advised.
+     */
+    RemapResult
+    remap_large(void* dst, void* src, size_t size, size_t large_class)
+    {
+      RemapResult r = PAL::remap_pages(dst, src, size);
+      if (r == RemapSourceRemapped)
+      {
+        bind_to_node(src, size, numa_node());
+        if constexpr (pal_supports<HugePages, PAL>)
+        {
+          if (large_class < huge_page_classes)
+            PAL::advise_huge_pages(src, size);
+        }
+        else
+        {
+          UNUSED(large_class);
+        }
+      }
+      return r;
+    }
   };
 
   using Stats = AllocStats<NUM_SIZECLASSES, NUM_LARGE_CLASSES>;
@@ -343,6 +1143,46 @@ namespace snmalloc
   template<class MemoryProvider>
   class LargeAlloc
   {
+    /**
+     * Number of large classes, starting with superslabs, that have a cache
+     * of free chunks in each allocator, see `LARGE_CACHE_SIZE`.  Chunks that
+     * decay must stay where the scan for decayed chunks can find them, so
+     * nothing is cached with that strategy.
+     */
+    static constexpr size_t cache_classes =
+      (decommit_strategy == DecommitSuperDecay) ?
+      0 :
+      bits::next_pow2_bits_const(LARGE_CACHE_SIZE + 1);
+
+    /**
+     * Free chunks of one large class held by this allocator.  They have
+     * been passed to `count_retained`, as they would have been on being
+     * pushed to the large stacks.
+     */
+    struct ChunkCache
+    {
+      Largeslab* head = nullptr;
+      size_t count = 0;
+    };
+
+    ModArray<(cache_classes == 0) ? 1 : cache_classes, ChunkCache> cache;
+
+    /**
+     * The memory provider's `cache_flush_requests` when this allocator's
+     * cache was last flushed.
+     */
+    uint64_t cache_flushed = 0;
+
+    /**
+     * The most chunks of the given large class held in this allocator's
+     * cache.
+     */
+    static constexpr size_t cache_capacity(size_t large_class)
+    {
+      return (large_class < cache_classes) ? (LARGE_CACHE_SIZE >> large_class) :
+                                             0;
+    }
+
   public:
     // This will be a zero-size structure if stats are not enabled.
     Stats stats;
@@ -351,6 +1191,22 @@ namespace snmalloc
 
     LargeAlloc(MemoryProvider& mp) : memory_provider(mp) {}
 
+    /**
+     * Whether a large allocation of `size` bytes, rounded up to a whole
+     * number of superslabs, is reserved directly from the platform.
+     */
+    static bool is_direct(size_t size)
+    {
+      return pal_supports<AddressRelease, MemoryProvider> &&
+        (LARGE_DIRECT_SIZE != 0) && (size >= LARGE_DIRECT_SIZE);
+    }
+
+    /**
+     * Allocate a chunk of the given large class to hold `size` bytes.  Only
+     * `size` bytes are committed, and the superslabs beyond them are
+     * returned to the large stacks, so the allocation is `size` rounded up
+     * to a whole number of superslabs.
+     */
     template<ZeroMem zero_mem = NoZero, AllowReserve allow_reserve = YesReserve>
     void* alloc(size_t large_class, size_t size)
     {
@@ -358,9 +1214,24 @@ namespace snmalloc
       // For superslab size, we always commit the whole range.
       if (large_class == 0)
         size = rsize;
+      size_t used = bits::align_up(size, SUPERSLAB_SIZE);
 
-      void* p = memory_provider.large_stack[large_class].pop();
+      if (is_direct(used))
+        return alloc_direct(size, SUPERSLAB_SIZE);
 
+      if constexpr (decommit_strategy == DecommitSuperDecay)
+        memory_provider.decay_tick();
+
+      // A larger chunk is split, returning the rest to the large stacks.
+      size_t chunk_class = large_class;
+      void* p = cache_pop(large_class);
+      if (p == nullptr)
+        p = memory_provider.pop_large(
+          large_class, memory_provider.numa_node(), chunk_class);
+
+      // Fresh space is not committed beyond `size`, as for `push_space`.
+      bool decommitted = true;
+      bool zeroed = pal_supports<LazyRelease, MemoryProvider>;
       if (p == nullptr)
       {
         p = memory_provider.template reserve<false>(large_class);
@@ -370,43 +1241,312 @@ namespace snmalloc
       }
       else
       {
-        stats.superslab_pop();
+        decommitted = reuse<zero_mem>(p, chunk_class, size, zeroed);
+        rsize = bits::one_at_bit(SUPERSLAB_BITS) << chunk_class;
+      }
 
-        // Cross-reference alloc.h's large_dealloc decommitment condition.
-        bool decommitted =
-          ((decommit_strategy == DecommitSuperLazy) &&
-           (static_cast<Baseslab*>(p)->get_kind() == Decommitted)) ||
-          (large_class > 0) || (decommit_strategy == DecommitSuper);
+      SNMALLOC_ASSERT(p == pointer_align_up(p, rsize));
+      stats.chunk_alloc(rsize);
+      dealloc_range(
+        pointer_offset(p, used), rsize - used, decommitted, zeroed);
+      return p;
+    }
 
-        if (decommitted)
+    /**
+     * Allocate `size` bytes aligned to `alignment` directly from the
+     * platform, for a size where `is_direct` holds.
+     */
+    void* alloc_direct(size_t size, size_t alignment)
+    {
+      if constexpr (pal_supports<AddressRelease, MemoryProvider>)
+      {
+        size_t used = bits::align_up(size, SUPERSLAB_SIZE);
+        void* p = memory_provider.reserve_direct(used, alignment);
+        if (p == nullptr)
+          return nullptr;
+
+        // Fresh pages already read as zero.
+        memory_provider.template notify_using<NoZero>(
+          p, bits::align_up(size, OS_PAGE_SIZE));
+        stats.chunk_alloc(used);
+        return p;
+      }
+      else
+      {
+        UNUSED(size);
+        UNUSED(alignment);
+        return nullptr;
+      }
+    }
+
+    /**
+     * Allocate a chunk of the given large class that is also aligned to
+     * `alignment`, if this allocator's cache of chunks holds one.  Returns
+     * nullptr otherwise, without reserving more address space.  The shared
+     * large stacks are not searched, as that would hide their chunks from
+     * other threads; the caller splits a chunk of the alignment's size
+     * instead, which is always aligned.
+     */
+    template<ZeroMem zero_mem = NoZero>
+    void* alloc_aligned(size_t large_class, size_t size, size_t alignment)
+    {
+      size_t rsize = bits::one_at_bit(SUPERSLAB_BITS) << large_class;
+      if (large_class == 0)
+        size = rsize;
+
+      auto aligned = [alignment](void* slab) {
+        return pointer_align_up(slab, alignment) == slab;
+      };
+      void* p = cache_take(large_class, aligned);
+      if (p == nullptr)
+        return nullptr;
+
+      bool zeroed;
+      bool decommitted = reuse<zero_mem>(p, large_class, size, zeroed);
+      stats.chunk_alloc(rsize);
+      size_t used = bits::align_up(size, SUPERSLAB_SIZE);
+      dealloc_range(
+        pointer_offset(p, used), rsize - used, decommitted, zeroed);
+      return p;
+    }
+
+    /**
+     * Remove the chunk `p` of the given large class from this allocator's
+     * cache or the large stacks, if it is in either.  On success,
+     * `decommitted` says whether the chunk needs to be recommitted.
+     */
+    bool take_chunk(void* p, size_t large_class, bool& decommitted)
+    {
+      if (cache_take(large_class, [p](void* slab) { return slab == p; }) ==
+          nullptr)
+        return memory_provider.take_chunk(p, large_class, decommitted);
+
+      decommitted = memory_provider.take_retained(p, large_class);
+      return true;
+    }
+
+    /**
+     * Return every chunk in this allocator's cache to the large stacks, so
+     * that other allocators can use them and `decommit_all` can reach them.
+     * This happens when the allocator is released to its pool, and at its
+     * next use of the cache after `request_cache_flush`.
+     */
+    void flush_cache()
+    {
+      cache_flushed = memory_provider.cache_flush_requests();
+      for (size_t large_class = 0; large_class < cache_classes; large_class++)
+      {
+        auto& c = cache[large_class];
+        if (c.head == nullptr)
+          continue;
+
+        Largeslab* last = c.head;
+        while (last->next.load(std::memory_order_relaxed) != nullptr)
+          last = last->next.load(std::memory_order_relaxed);
+        memory_provider.push_large_list(
+          c.head, last, large_class, memory_provider.numa_node());
+        c.head = nullptr;
+        c.count = 0;
+      }
+    }
+
+  private:
+    /**
+     * Flush this allocator's cache if the memory provider has asked for it
+     * since it was last flushed.  Returns whether it did.
+     */
+    bool flush_cache_if_requested()
+    {
+      if (likely(memory_provider.cache_flush_requests() == cache_flushed))
+        return false;
+      flush_cache();
+      return true;
+    }
+
+    /**
+     * Take a chunk of the given large class from this allocator's cache,
+     * first refilling half of the cache from the large stack if it is empty.
+     */
+    Largeslab* cache_pop(size_t large_class)
+    {
+      if (cache_capacity(large_class) == 0)
+        return nullptr;
+      flush_cache_if_requested();
+
+      auto& c = cache[large_class];
+      if (c.head == nullptr)
+      {
+        auto& stack =
+          memory_provider
+            .large_stack[memory_provider.numa_node()][large_class];
+        size_t batch = (cache_capacity(large_class) + 1) / 2;
+        while (c.count < batch)
         {
-          // The first page is already in "use" for the stack element,
-          // this will need zeroing for a YesZero call.
-          if constexpr (zero_mem == YesZero)
-            memory_provider.template zero<true>(p, OS_PAGE_SIZE);
-
-          // Notify we are using the rest of the allocation.
-          // Passing zero_mem ensures the PAL provides zeroed pages if
-          // required.
-          memory_provider.template notify_using<zero_mem>(
-            pointer_offset(p, OS_PAGE_SIZE),
-            bits::align_up(size, OS_PAGE_SIZE) - OS_PAGE_SIZE);
+          Largeslab* slab = stack.pop();
+          if (slab == nullptr)
+            break;
+          slab->next.store(c.head, std::memory_order_relaxed);
+          c.head = slab;
+          c.count++;
         }
+
+        if (c.head == nullptr)
+          return nullptr;
+      }
+
+      Largeslab* slab = c.head;
+      c.head = slab->next.load(std::memory_order_relaxed);
+      c.count--;
+      return slab;
+    }
+
+    /**
+     * Remove the first chunk of the given large class that satisfies
+     * `match` from this allocator's cache.
+     */
+    template<typename F>
+    Largeslab* cache_take(size_t large_class, F match)
+    {
+      if (cache_capacity(large_class) == 0)
+        return nullptr;
+
+      auto& c = cache[large_class];
+      Largeslab* prev = nullptr;
+      for (Largeslab* slab = c.head; slab != nullptr;
+           slab = slab->next.load(std::memory_order_relaxed))
+      {
+        if (match(slab))
+        {
+          auto next = slab->next.load(std::memory_order_relaxed);
+          if (prev == nullptr)
+            c.head = next;
+          else
+            prev->next.store(next, std::memory_order_relaxed);
+          c.count--;
+          return slab;
+        }
+        prev = slab;
+      }
+      return nullptr;
+    }
+
+    /**
+     * Put a freed chunk of the given large class in this allocator's cache,
+     * if it has one for that class.  When the cache overflows, half of it is
+     * returned to the large stack with a single push.
+     */
+    bool cache_push(void* p, size_t large_class)
+    {
+      size_t capacity = cache_capacity(large_class);
+      if ((capacity == 0) || flush_cache_if_requested())
+        return false;
+
+      auto slab = static_cast<Largeslab*>(p);
+      memory_provider.count_retained(slab, large_class);
+
+      auto& c = cache[large_class];
+      slab->next.store(c.head, std::memory_order_relaxed);
+      c.head = slab;
+      c.count++;
+
+      if (c.count > capacity)
+      {
+        // Keep the most recently freed half.
+        size_t keep = capacity / 2;
+        Largeslab* last = c.head;
+        for (size_t i = 1; i < keep; i++)
+          last = last->next.load(std::memory_order_relaxed);
+
+        Largeslab* first = c.head;
+        if (keep == 0)
+          c.head = nullptr;
         else
         {
-          // This is a superslab that has not been decommitted.
-          if constexpr (zero_mem == YesZero)
-            memory_provider.template zero<true>(
-              p, bits::align_up(size, OS_PAGE_SIZE));
+          first = last->next.load(std::memory_order_relaxed);
+          last->next.store(nullptr, std::memory_order_relaxed);
         }
+
+        last = first;
+        while (last->next.load(std::memory_order_relaxed) != nullptr)
+          last = last->next.load(std::memory_order_relaxed);
+
+        memory_provider.push_large_list(
+          first, last, large_class, memory_provider.numa_node());
+        c.count = keep;
       }
+      return true;
+    }
 
-      SNMALLOC_ASSERT(p == pointer_align_up(p, rsize));
-      return p;
+    /**
+     * Prepare a chunk just taken from the large stacks to hold `size` bytes.
+     * Returns whether the rest of the chunk is decommitted, for
+     * `dealloc_range`, and if so sets `zeroed` to whether it reads as zero.
+     */
+    template<ZeroMem zero_mem>
+    bool reuse(void* p, size_t large_class, size_t size, bool& zeroed)
+    {
+      stats.superslab_pop();
+
+      // Pages released lazily may still hold their old contents, so only
+      // skip zeroing those known to have been released immediately.
+      bool marked = static_cast<Baseslab*>(p)->get_kind() == Decommitted;
+      zeroed = marked && static_cast<Decommittedslab*>(p)->zeroed;
+
+      if (memory_provider.take_retained(p, large_class))
+      {
+        // The first page is already in "use" for the stack element,
+        // this will need zeroing for a YesZero call.
+        if constexpr (zero_mem == YesZero)
+          memory_provider.template zero<true>(p, OS_PAGE_SIZE);
+
+        // Notify we are using the rest of the allocation.
+        // Passing zero_mem ensures the PAL provides zeroed pages if
+        // required.
+        void* rest = pointer_offset(p, OS_PAGE_SIZE);
+        size_t rest_size = bits::align_up(size, OS_PAGE_SIZE) - OS_PAGE_SIZE;
+        if (zeroed)
+          memory_provider.template notify_using<NoZero>(rest, rest_size);
+        else
+          memory_provider.template notify_using<zero_mem>(rest, rest_size);
+
+        // Strategies that mark decommitted chunks may also treat unmarked
+        // chunks as decommitted, without having released all of them.
+        return marked || !marks_decommitted;
+      }
+
+      // This is a superslab that has not been decommitted.
+      if constexpr (zero_mem == YesZero)
+        memory_provider.template zero<true>(
+          p, bits::align_up(size, OS_PAGE_SIZE));
+      return false;
+    }
+
+    /**
+     * Whether chunks whose pages have been released are marked as
+     * `Decommittedslab`s in the large stacks.
+     */
+    static constexpr bool marks_decommitted =
+      (decommit_strategy == DecommitSuperLazy) ||
+      (decommit_strategy == DecommitSuperDecay);
+
+    /**
+     * Return a free chunk that needs no further decommit to the large
+     * stacks.
+     */
+    void push_free(void* p, size_t large_class)
+    {
+      stats.chunk_dealloc(bits::one_at_bit(SUPERSLAB_BITS) << large_class);
+      stats.superslab_push();
+      if (!cache_push(p, large_class))
+        memory_provider.push_large(
+          p, large_class, memory_provider.numa_node());
     }
 
+  public:
     void dealloc(void* p, size_t large_class)
     {
+      stats.chunk_dealloc(bits::one_at_bit(SUPERSLAB_BITS) << large_class);
+
       if constexpr (decommit_strategy == DecommitSuperLazy)
       {
         static_assert(
@@ -415,6 +1555,22 @@ namespace snmalloc
           "without low memory notifications");
       }
 
+      if constexpr (decommit_strategy == DecommitSuperDecay)
+      {
+        static_assert(
+          pal_supports<Time, MemoryProvider>,
+          "A decaying decommit strategy cannot be implemented on platforms "
+          "without a clock");
+
+        // Leave the chunk committed; the decay tick will decommit it if it is
+        // not reused in time.
+        stats.superslab_push();
+        memory_provider.push_decaying(
+          p, large_class, memory_provider.numa_node());
+        memory_provider.decay_tick();
+        return;
+      }
+
       // Cross-reference largealloc's alloc() decommitted condition.
       if (
         (decommit_strategy != DecommitNone) &&
@@ -427,7 +1583,66 @@ namespace snmalloc
       }
 
       stats.superslab_push();
-      memory_provider.large_stack[large_class].push(static_cast<Largeslab*>(p));
+      if (!cache_push(p, large_class))
+        memory_provider.push_large(
+          p, large_class, memory_provider.numa_node());
+    }
+
+    /**
+     * Return the superslabs in `[p, p + size)` to the large stacks, as the
+     * largest chunks that are aligned to their size.  Any part of the range
+     * may be decommitted.  If `decommitted` is set, all of it is, and reads
+     * as zero if `zeroed` is also set, so it is not released again.
+     */
+    void dealloc_range(
+      void* p, size_t size, bool decommitted = false, bool zeroed = false)
+    {
+      address_t start = address_cast(p);
+      address_t end = start + size;
+      while (start < end)
+      {
+        size_t chunk_bits = bits::ctz(start);
+        while (start + bits::one_at_bit(chunk_bits) > end)
+          chunk_bits--;
+        size_t large_class = chunk_bits - SUPERSLAB_BITS;
+
+        Largeslab* slab = pointer_cast<Largeslab>(start);
+        memory_provider.template notify_using<NoZero>(slab, OS_PAGE_SIZE);
+        if (decommitted && marks_decommitted)
+          new (slab) Decommittedslab(zeroed);
+        else
+          slab->init();
+        // Chunks that stay committed in the large stacks must be committed
+        // in full, as this range may only have been committed in part.
+        if (!MemoryProvider::is_decommitted(slab, large_class))
+          memory_provider.template notify_using<NoZero>(
+            slab, bits::one_at_bit(chunk_bits));
+
+        if (decommitted)
+          push_free(slab, large_class);
+        else
+          dealloc(slab, large_class);
+
+        start += bits::one_at_bit(chunk_bits);
+      }
+    }
+
+    /**
+     * Free a large allocation of `size` bytes, a whole number of superslabs,
+     * made by `alloc`.
+     */
+    void dealloc_large(void* p, size_t size)
+    {
+      if constexpr (pal_supports<AddressRelease, MemoryProvider>)
+      {
+        if (is_direct(size))
+        {
+          stats.chunk_dealloc(size);
+          memory_provider.unreserve(p, size);
+          return;
+        }
+      }
+      dealloc_range(p, size);
     }
   };
 
@@ -0,0 +1,243 @@
+#pragma once
+
+#include "threadalloc.h"
+
+#include <errno.h>
+#include <string.h>
+
+namespace snmalloc
+{
+  /**
+   * A jemalloc compatible `mallctl` namespace, so that tools written against
+   * jemalloc can introspect and control snmalloc.  The supported names are:
+   *
+   *  - `epoch`: read or write to refresh statistics.  Statistics are always
+   *    computed when read, so this only counts writes.
+   *  - `stats.allocated`: bytes in live objects, rounded up to their size
+   *    class.
+   *  - `stats.active`: bytes of chunks in use by allocators.
+   *  - `stats.mapped`: bytes of address space reserved from the platform,
+   *    less `stats.retained`.
+   *  - `stats.retained`: bytes of unused chunks that have been decommitted,
+   *    whose address space is kept for reuse.
+   *  - `arenas.narenas`, `arenas.nbins`, `arenas.nlextents`,
+   *    `arenas.bin.<j>.size` and `arenas.lextent.<j>.size` describe the size
+   *    classes.  There is a single arena covering every allocator.
+   *  - `stats.arenas.<i>.bins.<j>.curregs` and
+   *    `stats.arenas.<i>.lextents.<j>.curlextents`: live objects in each size
+   *    class.
+   *  - `thread.flush` (or `thread.tcache.flush`): send the calling thread's
+   *    cached remote frees to their owners, and return its cached free
+   *    chunks to the shared large stacks.
+   *  - `arena.purge` (or `arena.<i>.purge`): decommit all unused chunks,
+   *    except those cached by threads other than the caller.
+   *
+   * The statistics are aggregated from counters that every allocator keeps
+   * in all builds, so they are cheap enough to poll in production.
+   */
+  class Mallctl
+  {
+    /**
+     * jemalloc's `MALLCTL_ARENAS_ALL`, accepted as well as arena 0.
+     */
+    static constexpr size_t ARENAS_ALL = 4096;
+
+    /**
+     * Remove `prefix` from the front of `name` if it is there.
+     */
+    static bool consume(const char*& name, const char* prefix)
+    {
+      size_t length = strlen(prefix);
+      if (strncmp(name, prefix, length) != 0)
+        return false;
+
+      name += length;
+      return true;
+    }
+
+    /**
+     * Remove a decimal index and the following `.` from the front of `name`
+     * if they are there.
+     */
+    static bool consume_index(const char*& name, size_t& index)
+    {
+      const char* p = name;
+      index = 0;
+      while ((*p >= '0') && (*p <= '9'))
+        index = (index * 10) + static_cast<size_t>(*p++ - '0');
+
+      if ((p == name) || (*p != '.'))
+        return false;
+
+      name = p + 1;
+      return true;
+    }
+
+    static bool consume_arena(const char*& name)
+    {
+      size_t arena;
+      return consume_index(name, arena) &&
+        ((arena == 0) || (arena == ARENAS_ALL));
+    }
+
+    template<typename T>
+    static int read(T value, void* oldp, size_t* oldlenp, void* newp)
+    {
+      if (newp != nullptr)
+        return EPERM;
+
+      if (oldp != nullptr)
+      {
+        if ((oldlenp == nullptr) || (*oldlenp != sizeof(T)))
+          return EINVAL;
+        memcpy(oldp, &value, sizeof(T));
+      }
+      return 0;
+    }
+
+    /**
+     * Check that a name that performs an action is neither read nor written.
+     */
+    static bool is_action(void* oldp, void* newp)
+    {
+      return (oldp == nullptr) && (newp == nullptr);
+    }
+
+    static size_t allocated(Stats& stats)
+    {
+      size_t total = 0;
+      for (sizeclass_t i = 0; i < NUM_SIZECLASSES; i++)
+        total += stats.live_count[i].get() * sizeclass_to_size(i);
+
+      for (size_t i = 0; i < NUM_LARGE_CLASSES; i++)
+      {
+        total += stats.large_live_count[i].get() *
+          large_sizeclass_to_size(static_cast<uint8_t>(i));
+      }
+      return total;
+    }
+
+    static int stats(const char* name, void* oldp, size_t* oldlenp, void* newp)
+    {
+      Stats stats;
+      current_alloc_pool()->aggregate_stats(stats);
+      auto& mp = default_memory_provider();
+
+      if (strcmp(name, "allocated") == 0)
+        return read(allocated(stats), oldp, oldlenp, newp);
+      if (strcmp(name, "active") == 0)
+        return read(stats.active_bytes.get(), oldp, oldlenp, newp);
+      if (strcmp(name, "mapped") == 0)
+        return read(mp.reserved() - mp.retained(), oldp, oldlenp, newp);
+      if (strcmp(name, "retained") == 0)
+        return read(mp.retained(), oldp, oldlenp, newp);
+
+      size_t index;
+      if (!consume(name, "arenas.") || !consume_arena(name))
+        return ENOENT;
+
+      if (
+        consume(name, "bins.") && consume_index(name, index) &&
+        (index < NUM_SIZECLASSES) && (strcmp(name, "curregs") == 0))
+        return read(stats.live_count[index].get(), oldp, oldlenp, newp);
+
+      if (
+        consume(name, "lextents.") && consume_index(name, index) &&
+        (index < NUM_LARGE_CLASSES) && (strcmp(name, "curlextents") == 0))
+        return read(stats.large_live_count[index].get(), oldp, oldlenp, newp);
+
+      return ENOENT;
+    }
+
+    static int arenas(const char* name, void* oldp, size_t* oldlenp, void* newp)
+    {
+      if (strcmp(name, "narenas") == 0)
+        return read(1U, oldp, oldlenp, newp);
+      if (strcmp(name, "nbins") == 0)
+        return read(
+          static_cast<unsigned>(NUM_SIZECLASSES), oldp, oldlenp, newp);
+      if (strcmp(name, "nlextents") == 0)
+        return read(
+          static_cast<unsigned>(NUM_LARGE_CLASSES), oldp, oldlenp, newp);
+
+      size_t index;
+      if (
+        consume(name, "bin.") && consume_index(name, index) &&
+        (index < NUM_SIZECLASSES) && (strcmp(name, "size") == 0))
+        return read(sizeclass_to_size(index), oldp, oldlenp, newp);
+
+      if (
+        consume(name, "lextent.") && consume_index(name, index) &&
+        (index < NUM_LARGE_CLASSES) && (strcmp(name, "size") == 0))
+      {
+        return read(
+          large_sizeclass_to_size(static_cast<uint8_t>(index)),
+          oldp,
+          oldlenp,
+          newp);
+      }
+
+      return ENOENT;
+    }
+
+  public:
+    static int ctl(
+      const char* name,
+      void* oldp,
+      size_t* oldlenp,
+      void* newp,
+      size_t newlen)
+    {
+      static std::atomic<uint64_t> epoch{1};
+
+      if (name == nullptr)
+        return ENOENT;
+
+      if (strcmp(name, "epoch") == 0)
+      {
+        if (newp != nullptr)
+        {
+          if (newlen != sizeof(uint64_t))
+            return EINVAL;
+          epoch++;
+        }
+        return read(epoch.load(), oldp, oldlenp, nullptr);
+      }
+
+      if (
+        (strcmp(name, "thread.flush") == 0) ||
+        (strcmp(name, "thread.tcache.flush") == 0))
+      {
+        if (!is_action(oldp, newp))
+          return EPERM;
+        auto* a = ThreadAlloc::get_noncachable();
+        a->flush_remote_cache();
+        a->flush_large_cache();
+        return 0;
+      }
+
+      const char* rest = name;
+      if (
+        (strcmp(name, "arena.purge") == 0) ||
+        (consume(rest, "arena.") && consume_arena(rest) &&
+         (strcmp(rest, "purge") == 0)))
+      {
+        if (!is_action(oldp, newp))
+          return EPERM;
+        // Other allocators return their caches of free chunks the next time
+        // they use them, see `request_cache_flush`.
+        ThreadAlloc::get_noncachable()->flush_large_cache();
+        default_memory_provider().decommit_all();
+        return 0;
+      }
+
+      if (consume(name, "stats."))
+        return stats(name, oldp, oldlenp, newp);
+
+      if (consume(name, "arenas."))
+        return arenas(name, oldp, oldlenp, newp);
+
+      return ENOENT;
+    }
+  };
+} // namespace snmalloc
@@ -5,24 +5,30 @@
 #include "allocslab.h"
 #include "sizeclass.h"
 
+#include <utility>
+
 namespace snmalloc
 {
   class Mediumslab : public Allocslab
   {
     // This is the view of a 16 mb area when it is being used to allocate
-    // medium sized classes: 64 kb to 16 mb, non-inclusive.
+    // medium sized classes: MAX_SMALL_SIZE to 16 mb, non-inclusive.
   private:
     friend DLList<Mediumslab>;
 
+    // The number of slots in a slab of the smallest medium class.
+    static constexpr size_t MAX_SLOTS = (SUPERSLAB_SIZE - OS_PAGE_SIZE) /
+      bits::from_exp_mant<INTERMEDIATE_BITS, MIN_ALLOC_BITS>(NUM_SMALL_CLASSES);
+
     // Keep the allocator pointer on a separate cache line. It is read by
     // other threads, and does not change, so we avoid false sharing.
     alignas(CACHELINE_SIZE) Mediumslab* next;
     Mediumslab* prev;
 
     uint16_t free;
-    uint8_t head;
+    uint16_t head;
     uint8_t sizeclass;
-    uint16_t stack[SLAB_COUNT - 1];
+    uint16_t stack[MAX_SLOTS];
 
   public:
     static constexpr uint32_t header_size()
@@ -75,6 +81,17 @@ namespace snmalloc
       return sizeclass;
     }
 
+    /**
+     * Whether the free objects in this slab are kept decommitted.  `alloc`
+     * commits the whole object, as its usable size is the size class.
+     */
+    bool decommits_free()
+    {
+      return (decommit_strategy == DecommitSuper) &&
+        (MEDIUM_DECOMMIT_SIZE != 0) &&
+        (sizeclass_to_size(sizeclass) >= MEDIUM_DECOMMIT_SIZE);
+    }
+
     template<ZeroMem zero_mem, typename MemoryProvider>
     void* alloc(size_t size, MemoryProvider& memory_provider)
     {
@@ -85,15 +102,40 @@ namespace snmalloc
       free--;
 
       SNMALLOC_ASSERT(is_aligned_block<OS_PAGE_SIZE>(p, OS_PAGE_SIZE));
-      size = bits::align_up(size, OS_PAGE_SIZE);
 
-      if constexpr (zero_mem == YesZero)
-        memory_provider.template zero<true>(p, size);
+      if (decommits_free())
+        memory_provider.template notify_using<zero_mem>(
+          p, sizeclass_to_size(sizeclass));
+      else if constexpr (zero_mem == YesZero)
+        memory_provider.template zero<true>(
+          p, bits::align_up(size, OS_PAGE_SIZE));
 
       return p;
     }
 
-    bool dealloc(void* p)
+    /**
+     * Arrange for the next `alloc` to return a free slot aligned to
+     * `alignment`, if there is one.  Slots are only naturally aligned to
+     * the largest power of two dividing the size class, but some slots are
+     * aligned more strongly by their position in the slab.
+     */
+    bool prefer_aligned(size_t alignment)
+    {
+      SNMALLOC_ASSERT(alignment <= SUPERSLAB_SIZE);
+
+      for (size_t i = head; i < head + free; i++)
+      {
+        if (((static_cast<size_t>(stack[i]) << 8) & (alignment - 1)) == 0)
+        {
+          std::swap(stack[i], stack[head]);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    template<typename MemoryProvider>
+    bool dealloc(void* p, MemoryProvider& memory_provider)
     {
       SNMALLOC_ASSERT(head > 0);
 
@@ -102,6 +144,10 @@ namespace snmalloc
       free++;
       stack[--head] = pointer_to_index(p);
 
+      // An empty slab is decommitted as a whole when it is returned.
+      if (decommits_free() && !empty())
+        memory_provider.release_now(p, sizeclass_to_size(sizeclass));
+
       return was_full;
     }
 
@@ -58,6 +58,35 @@ namespace snmalloc
     // Initially zero to encode the superslabs relative list of slabs.
     uint8_t next = 0;
 
+    /**
+     * The `link` of an unused slab whose pages have been decommitted.  Real
+     * links are object offsets or 1 for a full slab, so they are never 2,
+     * and the zero initialised entries of a fresh superslab are committed.
+     * The sizeclass is left alone, as it may still be read through a stale
+     * pointer into the slab.
+     */
+    static constexpr uint16_t DECOMMITTED = 2;
+
+    bool is_decommitted()
+    {
+      return link == DECOMMITTED;
+    }
+
+    void set_decommitted()
+    {
+      SNMALLOC_ASSERT(is_unused());
+      link = DECOMMITTED;
+    }
+
+    /**
+     * Whether this unused slab has ever been allocated from.  A slab that
+     * is freed keeps the count it last had, which is never zero.
+     */
+    bool was_used()
+    {
+      return allocated != 0;
+    }
+
     /**
      * Updates statistics for adding an entry to the free list, if the
      * slab is either
@@ -70,6 +99,16 @@ namespace snmalloc
       return (--needed) == 0;
     }
 
+    /**
+     * How many objects in this slab are free.  Only meaningful for a slab
+     * on its size class list, which is neither full nor being bump
+     * allocated from.
+     */
+    uint16_t free_objects()
+    {
+      return static_cast<uint16_t>(allocated - needed);
+    }
+
     bool is_unused()
     {
       return needed == 0;
@@ -132,8 +171,13 @@ namespace snmalloc
 
     bool valid_head()
     {
+      if constexpr (SLAB_BITMAP)
+        return head == nullptr;
+
       size_t size = sizeclass_to_size(sizeclass);
-      size_t slab_end = (address_cast(head) | ~SLAB_MASK) + 1;
+      address_t slab = address_cast(head) & SLAB_MASK;
+      size_t slab_end = slab + SLAB_SIZE -
+        get_slab_colour(sizeclass, slab, (slab & ~SUPERSLAB_MASK) == 0);
       uintptr_t allocation_start =
         remove_cache_friendly_offset(address_cast(head), sizeclass);
 
@@ -150,6 +194,64 @@ namespace snmalloc
       return pointer_align_down<SUPERSLAB_SIZE>(p) == p;
     }
 
+    /**
+     * The end of the objects in `slab`, which is before the end of the slab
+     * when it is coloured.
+     */
+    static void* get_objects_end(Slab* slab, sizeclass_t sc)
+    {
+      return pointer_offset(
+        slab,
+        SLAB_SIZE - get_slab_colour(sc, address_cast(slab), is_short(slab)));
+    }
+
+    /**
+     * With `SLAB_BITMAP`, the free objects of a slab are marked in a bitmap
+     * at its start rather than linked from `head`, which stays empty.  The
+     * `link` object, and objects that have not been bump allocated yet, are
+     * not marked.
+     */
+    static size_t* get_bitmap(Slab* slab)
+    {
+      return pointer_offset(
+        reinterpret_cast<size_t*>(slab), slab_bitmap_offset(is_short(slab)));
+    }
+
+    /**
+     * The bit for the object containing `p`.  Objects are numbered from the
+     * end of the slab, so that this is the same for any pointer into the
+     * object.
+     */
+    static size_t get_bitmap_index(Slab* slab, sizeclass_t sc, void* p)
+    {
+      void* end = get_objects_end(slab, sc);
+      return divide_by_sizeclass(
+        sizeclass_to_size(sc), pointer_diff(p, end) - 1);
+    }
+
+    /**
+     * The start of the object for bit `index`.
+     */
+    static void* get_bitmap_object(Slab* slab, sizeclass_t sc, size_t index)
+    {
+      void* end = get_objects_end(slab, sc);
+      return pointer_offset_signed(
+        end, -static_cast<ptrdiff_t>((index + 1) * sizeclass_to_size(sc)));
+    }
+
+    /**
+     * Whether the object containing `p` is marked free in the bitmap.
+     */
+    static bool is_marked_free(Slab* slab, sizeclass_t sc, void* p)
+    {
+      if (slab_bitmap_words(sizeclass_to_size(sc)) == 0)
+        return false;
+
+      size_t index = get_bitmap_index(slab, sc, p);
+      size_t word = get_bitmap(slab)[index / bits::BITS];
+      return (word & bits::one_at_bit(index % bits::BITS)) != 0;
+    }
+
     /**
      * Check bump-free-list-segment for cycles
      *
@@ -207,17 +309,45 @@ namespace snmalloc
       if (is_unused())
         return;
 
+      // The objects of a coloured slab are moved towards its start, so they
+      // start earlier and end before the end of the slab.
+      size_t colour =
+        get_slab_colour(sizeclass, address_cast(slab), is_short);
       size_t size = sizeclass_to_size(sizeclass);
-      size_t offset = get_initial_offset(sizeclass, is_short);
+      size_t offset = get_initial_offset(sizeclass, is_short) - colour;
+      size_t end = SLAB_SIZE - colour;
       size_t accounted_for = needed * size + offset;
 
       // Block is not full
-      SNMALLOC_ASSERT(SLAB_SIZE > accounted_for);
+      SNMALLOC_ASSERT(end > accounted_for);
 
       // Keep variable so it appears in debugger.
       size_t length = debug_slab_acyclic_free_list(slab);
       UNUSED(length);
 
+      if constexpr (SLAB_BITMAP)
+      {
+        // Account for the objects marked free, which must all have been bump
+        // allocated, so be among the first `allocated` from the start.
+        size_t objects =
+          (SLAB_SIZE - get_initial_offset(sizeclass, is_short)) / size;
+        size_t* bitmap = get_bitmap(slab);
+        for (size_t i = 0; i < slab_bitmap_words(size); i++)
+        {
+          for (size_t word = bitmap[i]; word != 0; word &= word - 1)
+          {
+            size_t index = (i * bits::BITS) + bits::ctz(word);
+            SNMALLOC_ASSERT(index + allocated >= objects);
+            // The link object is never marked free.
+            SNMALLOC_ASSERT(
+              index !=
+              get_bitmap_index(slab, sizeclass, pointer_offset(slab, link)));
+            accounted_for += size;
+          }
+        }
+        SNMALLOC_ASSERT(end >= accounted_for);
+      }
+
       // Walk bump-free-list-segment accounting for unused space
       void* curr = head;
       while (curr != nullptr)
@@ -228,7 +358,7 @@ namespace snmalloc
 
         // Account for free elements in free list
         accounted_for += size;
-        SNMALLOC_ASSERT(SLAB_SIZE >= accounted_for);
+        SNMALLOC_ASSERT(end >= accounted_for);
         // We should never reach the link node in the free list.
         SNMALLOC_ASSERT(curr != pointer_offset(slab, link));
 
@@ -238,16 +368,16 @@ namespace snmalloc
 
       auto bumpptr = (allocated * size) + offset;
       // Check we haven't allocaated more than gits in a slab
-      SNMALLOC_ASSERT(bumpptr <= SLAB_SIZE);
+      SNMALLOC_ASSERT(bumpptr <= end);
 
       // Account for to be bump allocated space
-      accounted_for += SLAB_SIZE - bumpptr;
+      accounted_for += end - bumpptr;
 
-      if (bumpptr != SLAB_SIZE)
+      if (bumpptr != end)
       {
         // The link should be the first allocation as we
         // haven't completely filled this block at any point.
-        SNMALLOC_ASSERT(link == get_initial_offset(sizeclass, is_short));
+        SNMALLOC_ASSERT(link == offset);
       }
 
       SNMALLOC_ASSERT(!is_full());
@@ -255,7 +385,7 @@ namespace snmalloc
       accounted_for += size;
 
       // All space accounted for
-      SNMALLOC_ASSERT(SLAB_SIZE == accounted_for);
+      SNMALLOC_ASSERT(end == accounted_for);
 #else
       UNUSED(slab);
 #endif
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "../ds/eliminationstack.h"
 #include "../ds/flaglock.h"
-#include "../ds/mpmcstack.h"
+#include "../ds/helpers.h"
+#include "allocconfig.h"
 #include "pooled.h"
 
 namespace snmalloc
@@ -15,6 +17,9 @@ namespace snmalloc
    * concurrency safe.
    *
    * This is used to bootstrap the allocation of allocators.
+   *
+   * Released objects are kept on a stack per NUMA node, and acquire prefers
+   * objects last released on the caller's node.
    */
   template<class T, class MemoryProvider = GlobalVirtual>
   class Pool
@@ -25,7 +30,7 @@ namespace snmalloc
     friend class MemoryProviderStateMixin;
 
     std::atomic_flag lock = ATOMIC_FLAG_INIT;
-    MPMCStack<T, PreZeroed> stack;
+    ModArray<NUMA_NODES, EliminationStack<T, PreZeroed>> stack;
     T* list = nullptr;
 
     Pool(MemoryProvider& m) : memory_provider(m) {}
@@ -47,14 +52,19 @@ namespace snmalloc
     template<typename... Args>
     T* acquire(Args&&... args)
     {
-      T* p = stack.pop();
+      size_t node = memory_provider.numa_node();
+      for (size_t i = 0; i < NUMA_NODES; i++)
+      {
+        T* p = stack[node + i].pop();
 
-      if (p != nullptr)
-        return p;
+        if (p != nullptr)
+          return p;
+      }
 
-      p = memory_provider
-            .template alloc_chunk<T, bits::next_pow2_const(sizeof(T))>(
-              std::forward<Args...>(args)...);
+      T* p =
+        memory_provider
+          .template alloc_chunk<T, bits::next_pow2_const(sizeof(T))>(
+            std::forward<Args...>(args)...);
 
       FlagLock f(lock);
       p->list_next = list;
@@ -68,23 +78,24 @@ namespace snmalloc
       // The object's destructor is not run. If the object is "reallocated", it
       // is returned without the constructor being run, so the object is reused
       // without re-initialisation.
-      stack.push(p);
+      stack[memory_provider.numa_node()].push(p);
     }
 
-    T* extract(T* p = nullptr)
+    T* extract(T* p = nullptr, size_t node = 0)
     {
-      // Returns a linked list of all objects in the stack, emptying the stack.
+      // Returns a linked list of all objects in the stack for the given node,
+      // emptying the stack.
       if (p == nullptr)
-        return stack.pop_all();
+        return stack[node].pop_all();
 
       return p->next;
     }
 
-    void restore(T* first, T* last)
+    void restore(T* first, T* last, size_t node = 0)
     {
-      // Pushes a linked list of objects onto the stack. Use to put a linked
-      // list returned by extract back onto the stack.
-      stack.push(first, last);
+      // Pushes a linked list of objects onto the stack for the given node. Use
+      // to put a linked list returned by extract back onto the stack.
+      stack[node].push(first, last);
     }
 
     T* iterate(T* p = nullptr)
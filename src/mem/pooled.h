@@ -11,7 +11,7 @@ namespace snmalloc
     template<class TT, class MemoryProvider>
     friend class Pool;
     template<class TT, Construction c>
-    friend class MPMCStack;
+    friend class EliminationStack;
 
     /// Used by the pool for chaining together entries when not in use.
     std::atomic<T*> next = nullptr;
@@ -2,6 +2,7 @@
 
 #include "../ds/mpscq.h"
 #include "../mem/allocconfig.h"
+#include "../mem/metaslab.h"
 #include "../mem/sizeclass.h"
 
 #include <atomic>
@@ -12,6 +13,15 @@ namespace snmalloc
    * A region of memory destined for a remote allocator's dealloc() via the
    * message passing system.  This structure is placed at the beginning of
    * the allocation itself when it is queued for sending.
+   *
+   * A message can also free a batch of other objects from the same small
+   * slab.  Its `allocator_id` is then a tagged pointer to the most recently
+   * added of them, and they are linked from there, as a free list, through
+   * to the message itself, so that the owner can splice them onto the slab's
+   * free list as they are.  The most recently added object holds the size of
+   * the batch rather than an id, so the target of a batch message is found
+   * from its superslab.  Allocator ids are cache line aligned addresses, so
+   * they never have the tag bit set.
    */
   struct Remote
   {
@@ -24,21 +34,95 @@ namespace snmalloc
 
     alloc_id_t allocator_id;
 
+    static constexpr alloc_id_t BATCH = 1;
+
     void set_target_id(alloc_id_t id)
     {
+      SNMALLOC_ASSERT((id & BATCH) == 0);
       allocator_id = id;
     }
 
     alloc_id_t target_id()
     {
+      SNMALLOC_ASSERT(!is_batch());
       return allocator_id;
     }
+
+    bool is_batch()
+    {
+      return (allocator_id & BATCH) != 0;
+    }
+
+    /**
+     * The first of the other objects freed by this batch message.
+     */
+    Remote* get_batch()
+    {
+      SNMALLOC_ASSERT(is_batch());
+      return pointer_cast<Remote>(allocator_id & ~BATCH);
+    }
+
+    /**
+     * The number of other objects freed by this batch message.
+     */
+    size_t get_batch_size()
+    {
+      return get_batch()->allocator_id;
+    }
+
+    /**
+     * Make this message also free `r`, which must be in the same small slab.
+     */
+    void add_to_batch(Remote* r)
+    {
+      if (is_batch())
+      {
+        Remote* first = get_batch();
+        r->non_atomic_next = first;
+        r->allocator_id = first->allocator_id + 1;
+
+        // `first` is now inside the list, so make it an ordinary entry.
+        Metaslab::store_next(first, first->non_atomic_next);
+      }
+      else
+      {
+        // The list ends with the message itself.
+        r->non_atomic_next = this;
+        r->allocator_id = 1;
+      }
+      allocator_id = address_cast(r) | BATCH;
+    }
   };
 
   static_assert(
     sizeof(Remote) <= MIN_ALLOC_SIZE,
     "Needs to be able to fit in smallest allocation.");
 
+  /**
+   * The extra message queues of an allocator whose queue is contended.  They
+   * are allocated once, when the owner first sees the contention, and then
+   * kept for as long as the allocator.
+   */
+  struct RemoteLanes
+  {
+    struct alignas(CACHELINE_SIZE) Lane
+    {
+      MPSCQ<Remote> queue;
+    };
+
+    Lane lane[REMOTE_LANES];
+
+    bool is_empty()
+    {
+      for (auto& l : lane)
+      {
+        if (!l.queue.is_empty())
+          return false;
+      }
+      return true;
+    }
+  };
+
   struct RemoteAllocator
   {
     using alloc_id_t = Remote::alloc_id_t;
@@ -46,6 +130,98 @@ namespace snmalloc
     // is read by other threads.
     alignas(CACHELINE_SIZE) MPSCQ<Remote> message_queue;
 
+    /**
+     * Set by the owning allocator when it last found more messages in its
+     * queue than it handles in one go.  Read by senders to decide how much
+     * to batch.  This shares the cache line that senders already write to.
+     */
+    std::atomic<bool> congested = false;
+
+    /**
+     * How many times senders have found that another sender enqueued since
+     * they last did, since the owner last looked.  This is only approximate,
+     * as the senders do not update it atomically.
+     */
+    std::atomic<size_t> contention = 0;
+
+    /**
+     * The extra message queues, once the owner has added them.
+     */
+    std::atomic<RemoteLanes*> lanes = nullptr;
+
+    void set_congested(bool value)
+    {
+      if (congested.load(std::memory_order_relaxed) != value)
+        congested.store(value, std::memory_order_relaxed);
+    }
+
+    bool is_congested()
+    {
+      return congested.load(std::memory_order_relaxed);
+    }
+
+    void record_contention()
+    {
+      contention.store(
+        contention.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+    }
+
+    /**
+     * Called by the owner to find whether there has been enough contention
+     * since it last called this to be worth adding lanes.
+     */
+    bool take_contention()
+    {
+      size_t seen = contention.load(std::memory_order_relaxed);
+      if (seen == 0)
+        return false;
+
+      contention.store(0, std::memory_order_relaxed);
+      return seen >= REMOTE_LANE_CONTENTION;
+    }
+
+    /**
+     * The lane used by the sender `sender`.  Ids are addresses a large
+     * stride apart, so they are hashed to spread them over the lanes.
+     */
+    static size_t lane_index(alloc_id_t sender)
+    {
+      uint64_t hash = static_cast<uint64_t>(sender) * 0x9E3779B97F4A7C15;
+      return static_cast<size_t>(hash >> 40) & (REMOTE_LANES - 1);
+    }
+
+    /**
+     * Send the messages from `first` to `last` from the allocator `sender`.
+     * `sent` is the last message that `sender` sent here, or null if it does
+     * not know it.  The exchange at the back of the queue returns the
+     * previous last message, so the queue is known to be contended if that
+     * is not `sent`, without reading the back of the queue beforehand.
+     */
+    void
+    enqueue(Remote* first, Remote* last, alloc_id_t sender, Remote* sent)
+    {
+      if constexpr (REMOTE_LANES > 1)
+      {
+        RemoteLanes* l = lanes.load(std::memory_order_acquire);
+        if (l != nullptr)
+        {
+          l->lane[lane_index(sender)].queue.enqueue(first, last);
+          return;
+        }
+
+        Remote* prev = message_queue.enqueue(first, last);
+        if (unlikely((sent != nullptr) && (prev != sent)))
+          record_contention();
+      }
+      else
+      {
+        UNUSED(sender);
+        UNUSED(sent);
+        message_queue.enqueue(first, last);
+      }
+    }
+
     alloc_id_t id()
     {
       return static_cast<alloc_id_t>(
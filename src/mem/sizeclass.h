@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../ds/address.h"
 #include "../pal/pal_consts.h"
 #include "allocconfig.h"
 
@@ -18,6 +19,9 @@ namespace snmalloc
   constexpr static size_t
   sizeclass_to_inverse_cache_friendly_mask(sizeclass_t sc);
   constexpr static uint16_t medium_slab_free(sizeclass_t sizeclass);
+  static inline size_t
+  get_slab_colour(sizeclass_t sc, address_t slab, bool is_short);
+  constexpr static size_t slab_bitmap_offset(bool is_short);
   static sizeclass_t size_to_sizeclass(size_t size);
 
   constexpr static inline sizeclass_t size_to_sizeclass_const(size_t size)
@@ -38,14 +42,15 @@ namespace snmalloc
     return bits::one_at_bit(large_class + SUPERSLAB_BITS);
   }
 
-  // Small classes range from [MIN, SLAB], i.e. inclusive.
+  // Small classes range from [MIN, MAX_SMALL_SIZE], i.e. inclusive.
   static constexpr size_t NUM_SMALL_CLASSES =
-    size_to_sizeclass_const(bits::one_at_bit(SLAB_BITS)) + 1;
+    size_to_sizeclass_const(MAX_SMALL_SIZE) + 1;
 
   static constexpr size_t NUM_SIZECLASSES =
     size_to_sizeclass_const(SUPERSLAB_SIZE);
 
-  // Medium classes range from (SLAB, SUPERSLAB), i.e. non-inclusive.
+  // Medium classes range from (MAX_SMALL_SIZE, SUPERSLAB), i.e.
+  // non-inclusive.
   static constexpr size_t NUM_MEDIUM_CLASSES =
     NUM_SIZECLASSES - NUM_SMALL_CLASSES;
 
@@ -53,9 +58,27 @@ namespace snmalloc
   static constexpr size_t NUM_LARGE_CLASSES =
     bits::ADDRESS_BITS - SUPERSLAB_BITS;
 
-  inline static size_t round_by_sizeclass(size_t rsize, size_t offset)
+  /**
+   * The number of words in the free bitmap of a slab of objects of `rsize`
+   * bytes, which has a bit for each object that fits in the slab.  A slab of
+   * two objects never has a free object to mark, as one is its link and
+   * freeing the other empties it, so it needs no bitmap.
+   */
+  constexpr static inline size_t slab_bitmap_words(size_t rsize)
+  {
+    size_t objects = SLAB_SIZE / rsize;
+    if (objects <= 2)
+      return 0;
+
+    return (objects + bits::BITS - 1) / bits::BITS;
+  }
+
+  /**
+   * Calculates `offset / rsize`, the index of the object of `rsize` bytes
+   * that contains `offset`, without a division.
+   */
+  inline static size_t divide_by_sizeclass(size_t rsize, size_t offset)
   {
-    //    check_same<NUM_LARGE_CLASSES, Globals::num_large_classes>();
     // Must be called with a rounded size.
     SNMALLOC_ASSERT(sizeclass_to_size(size_to_sizeclass(rsize)) == rsize);
     // Only works up to certain offsets, exhaustively tested upto
@@ -68,7 +91,7 @@ namespace snmalloc
     if (INTERMEDIATE_BITS == 0 || divider == 1)
     {
       SNMALLOC_ASSERT(divider == 1);
-      return offset & ~(rsize - 1);
+      return offset >> align;
     }
 
     if constexpr (bits::is64() && INTERMEDIATE_BITS <= 2)
@@ -90,12 +113,33 @@ namespace snmalloc
                                                 (mul_shift / 5) + 1,
                                                 0,
                                                 (mul_shift / 7) + 1};
-      return ((constants[divider] * offset) >> back_shift) * rsize;
+      return (constants[divider] * offset) >> back_shift;
     }
     else
       // Use 32-bit division as considerably faster than 64-bit, and
       // everything fits into 32bits here.
-      return static_cast<uint32_t>(offset / rsize) * rsize;
+      return static_cast<uint32_t>(offset / rsize);
+  }
+
+  inline static size_t round_by_sizeclass(size_t rsize, size_t offset)
+  {
+    //    check_same<NUM_LARGE_CLASSES, Globals::num_large_classes>();
+    // Must be called with a rounded size.
+    SNMALLOC_ASSERT(sizeclass_to_size(size_to_sizeclass(rsize)) == rsize);
+    // Only works up to certain offsets, exhaustively tested upto
+    // SUPERSLAB_SIZE.
+    SNMALLOC_ASSERT(offset <= SUPERSLAB_SIZE);
+
+    size_t align = bits::ctz(rsize);
+    size_t divider = rsize >> align;
+    // Maximum of 24 bits for 16MiB super/medium slab
+    if (INTERMEDIATE_BITS == 0 || divider == 1)
+    {
+      SNMALLOC_ASSERT(divider == 1);
+      return offset & ~(rsize - 1);
+    }
+
+    return divide_by_sizeclass(rsize, offset) * rsize;
   }
 
   inline static bool is_multiple_of_sizeclass(size_t rsize, size_t offset)
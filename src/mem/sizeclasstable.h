@@ -19,7 +19,7 @@ namespace snmalloc
   }
 
   constexpr static size_t sizeclass_lookup_size =
-    sizeclass_lookup_index(SLAB_SIZE + 1);
+    sizeclass_lookup_index(MAX_SMALL_SIZE + 1);
 
   struct SizeClassTable
   {
@@ -29,6 +29,8 @@ namespace snmalloc
     ModArray<NUM_SIZECLASSES, size_t> inverse_cache_friendly_mask;
     ModArray<NUM_SMALL_CLASSES, uint16_t> initial_offset_ptr;
     ModArray<NUM_SMALL_CLASSES, uint16_t> short_initial_offset_ptr;
+    ModArray<NUM_SMALL_CLASSES, uint8_t> colour_mask;
+    ModArray<NUM_SMALL_CLASSES, uint8_t> colour_bits;
     ModArray<NUM_MEDIUM_CLASSES, uint16_t> medium_slab_slots;
 
     constexpr SizeClassTable()
@@ -37,6 +39,8 @@ namespace snmalloc
       inverse_cache_friendly_mask(),
       initial_offset_ptr(),
       short_initial_offset_ptr(),
+      colour_mask(),
+      colour_bits(),
       medium_slab_slots()
     {
       size_t curr = 1;
@@ -63,15 +67,29 @@ namespace snmalloc
 
       for (sizeclass_t i = 0; i < NUM_SMALL_CLASSES; i++)
       {
+        // The free bitmap, if there is one, comes before the objects.
+        size_t bitmap_size =
+          SLAB_BITMAP ? slab_bitmap_words(size[i]) * sizeof(size_t) : 0;
+
         // We align to the end of the block to remove special cases for the
         // short block. Calculate remainders
-        size_t short_correction = short_slab_size % size[i];
-        size_t correction = SLAB_SIZE % size[i];
+        size_t short_correction = (short_slab_size - bitmap_size) % size[i];
+        size_t correction = (SLAB_SIZE - bitmap_size) % size[i];
 
         // First element in the block is the link
-        initial_offset_ptr[i] = static_cast<uint16_t>(correction);
-        short_initial_offset_ptr[i] =
-          static_cast<uint16_t>(header_size + short_correction);
+        initial_offset_ptr[i] = static_cast<uint16_t>(bitmap_size + correction);
+        short_initial_offset_ptr[i] = static_cast<uint16_t>(
+          header_size + bitmap_size + short_correction);
+
+        // Colours are steps of at least a cache line that keep objects
+        // naturally aligned, and that fit in the space left over.  Use a
+        // power of two number of them, so picking one is a mask.
+        size_t step = bits::max(CACHELINE_SIZE, cache_friendly_mask[i] + 1);
+        size_t colours = bits::min<size_t>((correction / step) + 1, 256);
+        size_t colour_count =
+          bits::one_at_bit(bits::BITS - 1 - bits::clz_const(colours));
+        colour_mask[i] = static_cast<uint8_t>(colour_count - 1);
+        colour_bits[i] = static_cast<uint8_t>(bits::ctz_const(step));
       }
 
       for (sizeclass_t i = NUM_SMALL_CLASSES; i < NUM_SIZECLASSES; i++)
@@ -93,6 +111,41 @@ namespace snmalloc
     return sizeclass_metadata.initial_offset_ptr[sc];
   }
 
+  /**
+   * Where the free bitmap of a slab starts, which is after the superslab
+   * header for the short slab.
+   */
+  constexpr static inline size_t slab_bitmap_offset(bool is_short)
+  {
+    return is_short ? sizeof(Superslab) : 0;
+  }
+
+  /**
+   * How far the objects in `slab` are moved from the end of the slab towards
+   * its start, when slabs are coloured.  The colour rotates with the address
+   * of the slab, so it needs no metadata.  Short slabs are not coloured.
+   */
+  static inline size_t
+  get_slab_colour(sizeclass_t sc, address_t slab, bool is_short)
+  {
+    if constexpr (SLAB_COLOURING)
+    {
+      if (is_short)
+        return 0;
+
+      size_t colour =
+        (slab >> SLAB_BITS) & sizeclass_metadata.colour_mask[sc];
+      return colour << sizeclass_metadata.colour_bits[sc];
+    }
+    else
+    {
+      UNUSED(sc);
+      UNUSED(slab);
+      UNUSED(is_short);
+      return 0;
+    }
+  }
+
   constexpr static inline size_t sizeclass_to_size(sizeclass_t sizeclass)
   {
     return sizeclass_metadata.size[sizeclass];
@@ -112,10 +165,10 @@ namespace snmalloc
 
   static inline sizeclass_t size_to_sizeclass(size_t size)
   {
-    if ((size - 1) <= (SLAB_SIZE - 1))
+    if ((size - 1) <= (MAX_SMALL_SIZE - 1))
     {
       auto index = sizeclass_lookup_index(size);
-      SNMALLOC_ASSUME(index <= sizeclass_lookup_index(SLAB_SIZE));
+      SNMALLOC_ASSUME(index <= sizeclass_lookup_index(MAX_SMALL_SIZE));
       return sizeclass_metadata.sizeclass_lookup[index];
     }
 
@@ -54,8 +54,16 @@ namespace snmalloc
       meta.debug_slab_invariant(this);
 
       // Put everything in allocators small_class free list.
-      fast_free_list.value = meta.head;
-      meta.head = nullptr;
+      if constexpr (SLAB_BITMAP)
+      {
+        fast_free_list.value =
+          take_bitmap(meta.sizeclass, meta.free_objects() - 1u);
+      }
+      else
+      {
+        fast_free_list.value = meta.head;
+        meta.head = nullptr;
+      }
 
       // Return the link as the node for this allocation.
       void* link = pointer_offset(this, meta.link);
@@ -85,6 +93,49 @@ namespace snmalloc
       return p;
     }
 
+    /**
+     * Builds a free list of the `count` objects marked in the bitmap, in
+     * address order, and clears their bits.  The bitmap is scanned a word at
+     * a time from the end of the slab, and each object found is pushed on
+     * the front of the list, so the list starts with the lowest address.
+     */
+    void* take_bitmap(sizeclass_t sizeclass, size_t count)
+    {
+      size_t* bitmap = Metaslab::get_bitmap(this);
+      void* head = nullptr;
+
+      for (size_t i = 0; count > 0; i++)
+      {
+        size_t word = bitmap[i];
+        if (word == 0)
+          continue;
+
+        bitmap[i] = 0;
+        for (; word != 0; word &= word - 1)
+        {
+          size_t index = (i * bits::BITS) + bits::ctz(word);
+          void* p = Metaslab::get_bitmap_object(this, sizeclass, index);
+          Metaslab::store_next(p, head);
+          head = p;
+          count--;
+        }
+      }
+
+      SNMALLOC_ASSERT(count == 0);
+      return head;
+    }
+
+    /**
+     * Clears the bitmap of a slab that is about to be used for `sizeclass`.
+     */
+    void clear_bitmap(sizeclass_t sizeclass)
+    {
+      size_t* bitmap = Metaslab::get_bitmap(this);
+      size_t words = slab_bitmap_words(sizeclass_to_size(sizeclass));
+      for (size_t i = 0; i < words; i++)
+        bitmap[i] = 0;
+    }
+
     /**
      * Given a bumpptr and a fast_free_list head reference, builds a new free
      * list, and stores it in the fast_free_list. It will only create a page
@@ -97,12 +148,13 @@ namespace snmalloc
       fast_free_list.value = bumpptr;
       void* newbumpptr = pointer_offset(bumpptr, rsize);
       void* slab_end = pointer_align_up<SLAB_SIZE>(newbumpptr);
-      void* slab_end2 =
+      void* page_end =
         pointer_align_up<OS_PAGE_SIZE>(pointer_offset(bumpptr, rsize * 32));
-      if (slab_end2 < slab_end)
-        slab_end = slab_end2;
 
-      while (newbumpptr < slab_end)
+      // The objects of a coloured slab end before the slab does, so check
+      // that each one fits rather than that it starts before the end.
+      while ((newbumpptr < page_end) &&
+             (pointer_offset(newbumpptr, rsize) <= slab_end))
       {
         Metaslab::store_next(bumpptr, newbumpptr);
         bumpptr = newbumpptr;
@@ -111,14 +163,21 @@ namespace snmalloc
 
       Metaslab::store_next(bumpptr, nullptr);
       bumpptr = newbumpptr;
+
+      // Mark the slab as finished, skipping any space after the last object.
+      if (pointer_offset(bumpptr, rsize) > slab_end)
+        bumpptr = slab_end;
     }
 
     bool is_start_of_object(Superslab* super, void* p)
     {
       Metaslab& meta = super->get_meta(this);
-      return is_multiple_of_sizeclass(
-        sizeclass_to_size(meta.sizeclass),
-        pointer_diff(p, pointer_offset(this, SLAB_SIZE)));
+      size_t colour =
+        get_slab_colour(meta.sizeclass, address_cast(this), is_short());
+      void* end = pointer_offset(this, SLAB_SIZE - colour);
+      return (p < end) &&
+        is_multiple_of_sizeclass(
+               sizeclass_to_size(meta.sizeclass), pointer_diff(p, end));
     }
 
     // Returns true, if it deallocation can proceed without changing any status
@@ -135,6 +194,29 @@ namespace snmalloc
       if (unlikely(meta.return_object()))
         return false;
 
+      free_object(meta, p);
+      return true;
+    }
+
+    /**
+     * Adds `p` to the free objects of this slab, whose `needed` count has
+     * already been updated.
+     */
+    SNMALLOC_FAST_PATH void free_object(Metaslab& meta, void* p)
+    {
+      if constexpr (SLAB_BITMAP)
+      {
+        size_t index = Metaslab::get_bitmap_index(this, meta.sizeclass, p);
+        size_t& word = Metaslab::get_bitmap(this)[index / bits::BITS];
+        size_t bit = bits::one_at_bit(index % bits::BITS);
+#ifdef CHECK_CLIENT
+        if ((word & bit) != 0)
+          error("Detected potential double free.");
+#endif
+        word |= bit;
+        return;
+      }
+
       // Update the head and the next pointer in the free list.
       void* head = meta.head;
 
@@ -144,16 +226,49 @@ namespace snmalloc
 
       // Set the next pointer to the previous head.
       Metaslab::store_next(p, head);
+    }
 
-      return true;
+    /**
+     * Adds the free list from `first` to `last` to the free objects of this
+     * slab, whose `needed` count has already been updated.
+     */
+    SNMALLOC_FAST_PATH void free_list(Metaslab& meta, void* first, void* last)
+    {
+      SNMALLOC_ASSERT(!SLAB_BITMAP);
+
+      Metaslab::store_next(last, meta.head);
+      meta.head = first;
+      SNMALLOC_ASSERT(meta.valid_head());
+    }
+
+    /**
+     * Whether the object containing `p` is free in this slab, found without
+     * walking a list.  Requires `SLAB_BITMAP`.  Objects in an allocator's
+     * fast free list, or not yet bump allocated, are not free in the slab.
+     */
+    bool is_free(void* p)
+    {
+      if constexpr (!SLAB_BITMAP)
+        error("Requires the slab bitmap");
+
+      Metaslab& meta = get_meta();
+      if (meta.is_full() || meta.is_unused())
+        return meta.is_unused();
+
+      void* link = pointer_offset(this, meta.link);
+      sizeclass_t sc = meta.sizeclass;
+      return Metaslab::is_marked_free(this, sc, p) ||
+        (Metaslab::get_bitmap_index(this, sc, p) ==
+         Metaslab::get_bitmap_index(this, sc, link));
     }
 
     // If dealloc fast returns false, then call this.
     // This does not need to remove the "use" as done by the fast path.
     // Returns a complex return code for managing the superslab meta data.
     // i.e. This deallocation could make an entire superslab free.
-    SNMALLOC_SLOW_PATH typename Superslab::Action
-    dealloc_slow(SlabList* sl, Superslab* super, void* p)
+    template<typename MemoryProvider>
+    SNMALLOC_SLOW_PATH typename Superslab::Action dealloc_slow(
+      SlabList* sl, Superslab* super, void* p, MemoryProvider& mp)
     {
       Metaslab& meta = super->get_meta(this);
       meta.debug_slab_invariant(this);
@@ -167,7 +282,7 @@ namespace snmalloc
           if (is_short())
             return super->dealloc_short_slab();
 
-          return super->dealloc_slab(this);
+          return super->dealloc_slab(this, mp);
         }
         // Update the head and the sizeclass link.
         uint16_t index = pointer_to_index(p);
@@ -176,8 +291,9 @@ namespace snmalloc
         meta.link = index;
         meta.needed = meta.allocated - 1;
 
-        // Push on the list of slabs for this sizeclass.
-        sl->insert_prev(meta.get_link(this));
+        // Push on the front of the list of slabs for this sizeclass, as
+        // with one free object it is as full as a slab on the list can be.
+        sl->insert_next(meta.get_link(this));
         meta.debug_slab_invariant(this);
         return Superslab::NoSlabReturn;
       }
@@ -188,7 +304,7 @@ namespace snmalloc
       if (is_short())
         return super->dealloc_short_slab();
 
-      return super->dealloc_slab(this);
+      return super->dealloc_slab(this, mp);
     }
 
     bool is_short()
@@ -115,6 +115,24 @@ namespace snmalloc
 #endif
     }
 
+    /**
+     * Twice the number of slabs in use, plus one for the short slab, so
+     * fuller superslabs have larger values.
+     */
+    size_t get_used()
+    {
+      return used;
+    }
+
+    /**
+     * The superslab after this one on the allocator's list of superslabs
+     * with space.
+     */
+    Superslab* get_next()
+    {
+      return next;
+    }
+
     bool is_empty()
     {
       return used == 0;
@@ -155,10 +173,11 @@ namespace snmalloc
       return meta[slab_to_index(slab)];
     }
 
-    Slab* alloc_short_slab(sizeclass_t sizeclass)
+    template<typename MemoryProvider>
+    Slab* alloc_short_slab(sizeclass_t sizeclass, MemoryProvider& mp)
     {
       if ((used & 1) == 1)
-        return alloc_slab(sizeclass);
+        return alloc_slab(sizeclass, mp);
 
       meta[0].head = nullptr;
       // Set up meta data as if the entire slab has been turned into a free
@@ -177,7 +196,8 @@ namespace snmalloc
       return reinterpret_cast<Slab*>(this);
     }
 
-    Slab* alloc_slab(sizeclass_t sizeclass)
+    template<typename MemoryProvider>
+    Slab* alloc_slab(sizeclass_t sizeclass, MemoryProvider& mp)
     {
       uint8_t h = head;
       Slab* slab = pointer_cast<Slab>(
@@ -185,6 +205,9 @@ namespace snmalloc
 
       uint8_t n = meta[h].next;
 
+      if (meta[h].is_decommitted())
+        mp.template notify_using<NoZero>(slab, SLAB_SIZE);
+
       meta[h].head = nullptr;
       // Set up meta data as if the entire slab has been turned into a free
       // list. This means we don't have to check for special cases where we have
@@ -205,7 +228,8 @@ namespace snmalloc
     }
 
     // Returns true, if this alters the value of get_status
-    Action dealloc_slab(Slab* slab)
+    template<typename MemoryProvider>
+    Action dealloc_slab(Slab* slab, MemoryProvider& mp)
     {
       // This is not the short slab.
       uint8_t index = static_cast<uint8_t>(slab_to_index(slab));
@@ -219,11 +243,51 @@ namespace snmalloc
 
       SNMALLOC_ASSERT(meta[index].is_unused());
       if (was_almost_full || is_empty())
+      {
+        // An empty superslab is about to be returned as a whole.
+        if (!is_empty())
+          decommit_retained(mp);
         return StatusChange;
+      }
 
+      decommit_retained(mp);
       return NoStatusChange;
     }
 
+    /**
+     * Decommit the first freed slab beyond the `DECOMMIT_SLAB_RETAIN` at
+     * the head of the free slab list.  Slabs are freed and reused from the
+     * head, so calling this on each free keeps all but that many of them
+     * decommitted.  The pages are released immediately, as any slab beyond
+     * the window is not expected to be reused soon.
+     */
+    template<typename MemoryProvider>
+    void decommit_retained(MemoryProvider& mp)
+    {
+      if constexpr (decommit_strategy == DecommitSuper)
+      {
+        size_t curr = head;
+        for (size_t i = 0; i < DECOMMIT_SLAB_RETAIN; i++)
+        {
+          curr = (curr + meta[curr].next + 1) & (SLAB_COUNT - 1);
+          // The list ends at the short slab.
+          if (curr == 0)
+            return;
+        }
+
+        Metaslab& m = meta[curr];
+        if (m.is_decommitted() || !m.was_used())
+          return;
+
+        mp.release_now(pointer_offset(this, curr << SLAB_BITS), SLAB_SIZE);
+        m.set_decommitted();
+      }
+      else
+      {
+        UNUSED(mp);
+      }
+    }
+
     // Returns true, if this alters the value of get_status
     Action dealloc_short_slab()
     {
@@ -1,3 +1,4 @@
+#include "../mem/mallctl.h"
 #include "../mem/slowalloc.h"
 #include "../snmalloc.h"
 
@@ -48,6 +49,38 @@ extern "C"
     return Alloc::alloc_size(ptr);
   }
 
+  /**
+   * Extension: allocate `n` objects of `size` bytes into `out`.  Returns the
+   * number of objects allocated, which is less than `n` only if memory is
+   * exhausted.
+   */
+  SNMALLOC_EXPORT size_t SNMALLOC_NAME_MANGLE(snmalloc_alloc_batch)(
+    size_t size, void** out, size_t n)
+  {
+    return ThreadAlloc::get_noncachable()->alloc_batch(size, out, n);
+  }
+
+  /**
+   * Extension: free `n` objects, each allocated with `size` bytes.
+   */
+  SNMALLOC_EXPORT void SNMALLOC_NAME_MANGLE(snmalloc_dealloc_batch)(
+    void** ptrs, size_t n, size_t size)
+  {
+    ThreadAlloc::get_noncachable()->dealloc_batch(ptrs, n, size);
+  }
+
+  /**
+   * Extension: write the live heap profile into `buf` in pprof's legacy heap
+   * text format.  Returns the length of the whole profile, which is more than
+   * `len` if it was truncated.  The profile is empty unless built with
+   * SNMALLOC_HEAP_PROFILE.
+   */
+  SNMALLOC_EXPORT size_t
+    SNMALLOC_NAME_MANGLE(snmalloc_heap_profile)(char* buf, size_t len)
+  {
+    return HeapProfile::get().dump(buf, len);
+  }
+
   SNMALLOC_EXPORT void* SNMALLOC_NAME_MANGLE(realloc)(void* ptr, size_t size)
   {
     if (size == (size_t)-1)
@@ -74,16 +107,31 @@ extern "C"
     }
 #endif
     size_t sz = Alloc::alloc_size(ptr);
+    auto a = ThreadAlloc::get_noncachable();
+
     // Keep the current allocation if the given size is in the same sizeclass.
-    if (sz == sizeclass_to_size(size_to_sizeclass(size)))
+    // Large sizes have no sizeclass, and are handled below.
+    constexpr size_t max_medium = sizeclass_to_size(NUM_SIZECLASSES - 1);
+    if (
+      (size <= max_medium) &&
+      (sz == sizeclass_to_size(size_to_sizeclass(size))))
+      return ptr;
+
+    // Large allocations can often grow into the free chunks that follow
+    // them, and can always shrink, without copying.
+    if (a->resize_large_in_place(ptr, size))
       return ptr;
 
     void* p = SNMALLOC_NAME_MANGLE(malloc)(size);
     if (p != nullptr)
     {
       SNMALLOC_ASSERT(p == Alloc::external_pointer<Start>(p));
+      bool large = (sz > max_medium) && (size > max_medium);
       sz = bits::min(size, sz);
-      memcpy(p, ptr, sz);
+      if (!large)
+        memcpy(p, ptr, sz);
+      else if (!a->move_large(p, ptr, sz))
+        return p; // `ptr` has no pages left to reuse, so it is leaked.
       SNMALLOC_NAME_MANGLE(free)(ptr);
     }
     return p;
@@ -119,8 +167,8 @@ extern "C"
       return nullptr;
     }
 
-    return SNMALLOC_NAME_MANGLE(malloc)(
-      size ? aligned_size(alignment, size) : alignment);
+    return ThreadAlloc::get_noncachable()->alloc_aligned(
+      alignment, size ? size : alignment);
   }
 
   SNMALLOC_EXPORT void*
@@ -176,10 +224,14 @@ extern "C"
   SNMALLOC_EXPORT void SNMALLOC_NAME_MANGLE(_malloc_postfork)(void) {}
   SNMALLOC_EXPORT void SNMALLOC_NAME_MANGLE(_malloc_first_thread)(void) {}
 
-  SNMALLOC_EXPORT int
-    SNMALLOC_NAME_MANGLE(mallctl)(const char*, void*, size_t*, void*, size_t)
+  /**
+   * jemalloc compatible introspection and control, see `Mallctl` for the
+   * supported names.
+   */
+  SNMALLOC_EXPORT int SNMALLOC_NAME_MANGLE(mallctl)(
+    const char* name, void* oldp, size_t* oldlenp, void* newp, size_t newlen)
   {
-    return ENOENT;
+    return Mallctl::ctl(name, oldp, oldlenp, newp, newlen);
   }
 
 #ifdef SNMALLOC_EXPOSE_PAGEMAP
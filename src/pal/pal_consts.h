@@ -36,6 +36,62 @@ namespace snmalloc
      * exposed in the Pal.
      */
     LazyCommit = (1 << 2),
+    /**
+     * This PAL can back address ranges with huge (e.g. 2 MiB) pages to reduce
+     * TLB pressure.  A PAL that supports this must expose an
+     * `advise_huge_pages()` method that takes a range and hints that it should
+     * be backed by huge pages.  This is only a hint and failure is ignored.
+     */
+    HugePages = (1 << 3),
+    /**
+     * This PAL provides a cheap monotonic clock.  It must expose a static
+     * `time_in_ms()` method that returns a millisecond count from some fixed
+     * point in the past.
+     */
+    Time = (1 << 4),
+    /**
+     * This PAL can report which NUMA node the calling thread is running on
+     * and can bind memory to a preferred node.  It must expose a static
+     * `get_numa_node()` method returning the node of the calling thread and a
+     * `bind_numa_node()` method that takes a range and a node.  Binding is
+     * only a preference and failure is ignored.
+     */
+    NumaLocality = (1 << 5),
+    /**
+     * This PAL can capture the return addresses on the calling thread's
+     * stack.  It must expose a static `capture_backtrace()` method that takes
+     * an array of frames and its length, and returns the number filled in.
+     */
+    Backtrace = (1 << 6),
+    /**
+     * This PAL can move the pages backing a range of memory to another
+     * address without copying them.  It must expose a static `remap_pages()`
+     * method that takes a destination, a source and a page-aligned size, and
+     * returns a `RemapResult`.  Unless the result is `RemapSourceLost`, the
+     * source must still be reserved and usable afterwards, with undefined
+     * contents.
+     */
+    PageRemap = (1 << 7),
+    /**
+     * This PAL's `notify_not_using()` may leave pages resident until the
+     * platform runs short of memory, so that reusing them soon is cheap.  It
+     * must also expose a `notify_not_using_now()` method that releases the
+     * pages immediately, after which they read as zero.
+     */
+    LazyRelease = (1 << 8),
+    /**
+     * This PAL can return reserved address space to the platform.  It must
+     * expose an `unreserve()` method that takes a page-aligned range, which
+     * may be part of a larger reservation.
+     */
+    AddressRelease = (1 << 9),
+    /**
+     * Address space reserved from this PAL by separate calls behaves as one
+     * range where the reservations are adjacent, so that committing or
+     * decommitting may span the boundary between them.  Free chunks of
+     * address space are only merged with their neighbours if this holds.
+     */
+    MergeableReservations = (1 << 10),
   };
   /**
    * Flag indicating whether requested memory should be zeroed.
@@ -53,6 +109,31 @@ namespace snmalloc
     YesZero
   };
 
+  /**
+   * The outcome of `remap_pages()` on a PAL with the `PageRemap` feature.
+   */
+  enum RemapResult
+  {
+    /**
+     * Nothing was moved, and both ranges are unchanged.
+     */
+    RemapFailed,
+    /**
+     * The pages were moved, and the source is still mapped as it was.
+     */
+    RemapMoved,
+    /**
+     * The pages were moved, and the source was mapped again without any
+     * advice or memory policy it had before.
+     */
+    RemapSourceRemapped,
+    /**
+     * The pages were moved, but the source could not be mapped again.  It
+     * must not be used or returned to the platform.
+     */
+    RemapSourceLost
+  };
+
   /**
    * Default Tag ID for the Apple class
    */
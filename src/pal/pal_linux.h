@@ -5,8 +5,25 @@
 #  include "../mem/allocconfig.h"
 #  include "pal_posix.h"
 
+#  include <errno.h>
+#  include <sched.h>
 #  include <string.h>
 #  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#  ifdef __GLIBC__
+#    include <execinfo.h>
+#  endif
+
+// glibc provides a `getcpu` wrapper, which uses the vDSO, from 2.29.
+#  if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#    if __GLIBC_PREREQ(2, 29)
+#      define SNMALLOC_LINUX_VDSO_GETCPU 1
+#    endif
+#  endif
+#  ifndef SNMALLOC_LINUX_VDSO_GETCPU
+#    define SNMALLOC_LINUX_VDSO_GETCPU 0
+#  endif
 
 extern "C" int puts(const char* str);
 
@@ -19,12 +36,190 @@ namespace snmalloc
      * Bitmap of PalFeatures flags indicating the optional features that this
      * PAL supports.
      *
-     * Linux does not support any features other than those in a generic POSIX
-     * platform.  This field is declared explicitly to remind anyone who
-     * extends this PAL that they may need to extend the set of advertised
-     * features.
+     * In addition to the features of a generic POSIX platform, Linux can
+     * back memory with transparent huge pages when `MADV_HUGEPAGE` is
+     * available, supports NUMA placement via `getcpu` and `mbind`, can
+     * capture backtraces with glibc, can move pages with `mremap`, and
+     * releases pages lazily with `MADV_FREE`.
      */
-    static constexpr uint64_t pal_features = PALPOSIX::pal_features;
+    static constexpr uint64_t pal_features =
+      PALPOSIX::pal_features | LazyRelease
+#  ifdef MADV_HUGEPAGE
+      | HugePages
+#  endif
+#  if defined(SYS_getcpu) && defined(SYS_mbind)
+      | NumaLocality
+#  endif
+#  ifdef __GLIBC__
+      | Backtrace
+#  endif
+#  ifdef MREMAP_FIXED
+      | PageRemap
+#  endif
+      ;
+
+    /**
+     * Size of a huge page on the platforms we target (x86-64 and AArch64
+     * with 4 KiB base pages).
+     */
+    static constexpr size_t huge_page_size = bits::one_at_bit(21);
+
+    /**
+     * Hint that the range should be backed by transparent huge pages.
+     *
+     * This only has an effect on the 2 MiB aligned portions of the range,
+     * and is ignored if the kernel has transparent huge pages disabled.
+     */
+    void advise_huge_pages(void* p, size_t size) noexcept
+    {
+      SNMALLOC_ASSERT(is_aligned_block<OS_PAGE_SIZE>(p, size));
+#  ifdef MADV_HUGEPAGE
+      madvise(p, size, MADV_HUGEPAGE);
+#  else
+      UNUSED(p);
+      UNUSED(size);
+#  endif
+    }
+
+#  ifdef __GLIBC__
+    /**
+     * Fill `frames` with up to `depth` return addresses from the calling
+     * thread's stack.  The first call may allocate, as glibc loads the
+     * unwinder on demand.
+     */
+    static size_t capture_backtrace(void** frames, size_t depth) noexcept
+    {
+      int count = backtrace(frames, static_cast<int>(depth));
+      return count < 0 ? 0 : static_cast<size_t>(count);
+    }
+#  endif
+
+#  ifdef MREMAP_FIXED
+    /**
+     * Move the pages backing `size` bytes at `src` over those at `dst`,
+     * leaving fresh zero pages at `src` so that its address space stays
+     * reserved.  Returns `RemapFailed`, having changed nothing, if the kernel
+     * cannot move the range, for example because it spans several mappings.
+     *
+     * `MREMAP_DONTUNMAP` (Linux 5.7) keeps the mapping at `src`, along with
+     * its advice and memory policy.  Older kernels unmap `src`, so it is
+     * mapped again here, which can fail if the process has run out of
+     * mappings.
+     */
+    static RemapResult remap_pages(void* dst, void* src, size_t size) noexcept
+    {
+      SNMALLOC_ASSERT(is_aligned_block<OS_PAGE_SIZE>(src, size));
+#    ifdef MREMAP_DONTUNMAP
+      void* r = mremap(
+        src,
+        size,
+        size,
+        MREMAP_MAYMOVE | MREMAP_FIXED | MREMAP_DONTUNMAP,
+        dst);
+      if (r != MAP_FAILED)
+        return RemapMoved;
+      if (errno != EINVAL)
+        return RemapFailed;
+#    endif
+
+      if (mremap(src, size, size, MREMAP_MAYMOVE | MREMAP_FIXED, dst) ==
+          MAP_FAILED)
+        return RemapFailed;
+
+      void* p = mmap(
+        src,
+        size,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+        -1,
+        0);
+      return p == MAP_FAILED ? RemapSourceLost : RemapSourceRemapped;
+    }
+#  endif
+
+#  if defined(SYS_getcpu) && defined(SYS_mbind)
+    /**
+     * Return the NUMA node that the calling thread is currently running on.
+     * This is called on every large stack and pool operation, so it must not
+     * enter the kernel each time.  glibc's `getcpu` uses the vDSO.  Without
+     * it, the node is cached per thread and only looked up every so often,
+     * which is enough for a hint.
+     */
+    static size_t get_numa_node() noexcept
+    {
+      unsigned cpu = 0;
+      unsigned node = 0;
+#    if SNMALLOC_LINUX_VDSO_GETCPU
+      if (getcpu(&cpu, &node) != 0)
+        return 0;
+      return node;
+#    else
+      static constexpr unsigned refresh_interval = 64;
+      static thread_local unsigned cached_node = 0;
+      static thread_local unsigned calls = 0;
+
+      if ((calls++ % refresh_interval) == 0)
+      {
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+          cached_node = node;
+      }
+      return cached_node;
+#    endif
+    }
+
+    /**
+     * Prefer to place pages in this range on the given NUMA node when they
+     * are first touched.  Uses the raw system call so that there is no
+     * dependency on libnuma.
+     */
+    static void bind_numa_node(void* p, size_t size, size_t node) noexcept
+    {
+      // MPOL_PREFERRED from linux/mempolicy.h, which we avoid including as
+      // it conflicts with libnuma's numaif.h.
+      static constexpr int mpol_preferred = 1;
+
+      if (node >= bits::BITS)
+        return;
+
+      // The kernel ignores the last bit of `maxnode`, so pass one more.
+      unsigned long mask = 1UL << node;
+      syscall(SYS_mbind, p, size, mpol_preferred, &mask, bits::BITS + 1, 0);
+    }
+#  endif
+
+    /**
+     * Notify platform that we will not be using these pages.
+     *
+     * `MADV_FREE` lets the kernel reclaim the pages only when it needs the
+     * memory, so chunks that are reused soon do not fault their pages back
+     * in.  Until the pages are next written their contents are undefined:
+     * they may be zero or may hold their old contents.  Kernels before 4.5
+     * reject `MADV_FREE`, so fall back to releasing the pages immediately.
+     */
+    void notify_not_using(void* p, size_t size) noexcept
+    {
+      SNMALLOC_ASSERT(is_aligned_block<OS_PAGE_SIZE>(p, size));
+#  ifdef MADV_FREE
+      if (madvise(p, size, MADV_FREE) == 0)
+      {
+        PALPOSIX::notify_not_using(p, size);
+        return;
+      }
+#  endif
+      notify_not_using_now(p, size);
+    }
+
+    /**
+     * Release these pages immediately, for when the memory is not expected
+     * to be reused soon.  `MADV_DONTNEED` drops the pages, so they read as
+     * zero when next touched.
+     */
+    void notify_not_using_now(void* p, size_t size) noexcept
+    {
+      SNMALLOC_ASSERT(is_aligned_block<OS_PAGE_SIZE>(p, size));
+      madvise(p, size, MADV_DONTNEED);
+      PALPOSIX::notify_not_using(p, size);
+    }
 
     /**
      * OS specific function for zeroing memory.
@@ -32,7 +227,8 @@ namespace snmalloc
      * Linux implements an unusual interpretation of `MADV_DONTNEED`, which
      * immediately resets the pages to the zero state (rather than marking them
      * as sensible ones to swap out in high memory pressure).  We use this to
-     * clear the underlying memory range.
+     * clear the underlying memory range.  If the kernel refuses, we fall
+     * back to `memset`.
      */
     template<bool page_aligned = false>
     void zero(void* p, size_t size) noexcept
@@ -47,13 +243,11 @@ namespace snmalloc
         // Only use this on large allocations as memset faster, and doesn't
         // introduce IPI so faster for small allocations.
         SNMALLOC_ASSERT(is_aligned_block<OS_PAGE_SIZE>(p, size));
-        madvise(p, size, MADV_DONTNEED);
+        if (madvise(p, size, MADV_DONTNEED) == 0)
+          return;
       }
-      else
 #  endif
-      {
-        ::memset(p, 0, size);
-      }
+      ::memset(p, 0, size);
     }
   };
 } // namespace snmalloc
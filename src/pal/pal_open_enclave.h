@@ -17,8 +17,11 @@ namespace snmalloc
     /**
      * Bitmap of PalFeatures flags indicating the optional features that this
      * PAL supports.
+     *
+     * Reservations are carved out of a single heap, so adjacent ones can be
+     * merged.
      */
-    static constexpr uint64_t pal_features = 0;
+    static constexpr uint64_t pal_features = MergeableReservations;
     static void error(const char* const str)
     {
       UNUSED(str);
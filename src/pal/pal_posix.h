@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <time.h>
 
 extern "C" int puts(const char* str);
 
@@ -31,9 +32,11 @@ namespace snmalloc
      * Bitmap of PalFeatures flags indicating the optional features that this
      * PAL supports.
      *
-     * POSIX systems are assumed to support lazy commit.
+     * POSIX systems are assumed to support lazy commit, a monotonic clock,
+     * unmapping any part of a mapping and treating adjacent mappings as one.
      */
-    static constexpr uint64_t pal_features = LazyCommit;
+    static constexpr uint64_t pal_features =
+      LazyCommit | Time | AddressRelease | MergeableReservations;
 
     /**
      * Report a fatal error an exit.
@@ -44,6 +47,17 @@ namespace snmalloc
       abort();
     }
 
+    /**
+     * Milliseconds since some unspecified point, from the monotonic clock.
+     */
+    static uint64_t time_in_ms() noexcept
+    {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return (static_cast<uint64_t>(ts.tv_sec) * 1000) +
+        (static_cast<uint64_t>(ts.tv_nsec) / 1000000);
+    }
+
     /**
      * Notify platform that we will not be using these pages.
      *
@@ -144,5 +158,14 @@ namespace snmalloc
 
       return p;
     }
+
+    /**
+     * Return reserved memory to the platform.
+     */
+    void unreserve(void* p, size_t size) noexcept
+    {
+      SNMALLOC_ASSERT(is_aligned_block<OS_PAGE_SIZE>(p, size));
+      munmap(p, size);
+    }
   };
 } // namespace snmalloc
@@ -75,9 +75,11 @@ namespace snmalloc
 
     /**
      * Bitmap of PalFeatures flags indicating the optional features that this
-     * PAL supports.  This PAL supports low-memory notifications.
+     * PAL supports.  This PAL supports low-memory notifications, a
+     * monotonic clock and capturing backtraces.
      */
-    static constexpr uint64_t pal_features = LowMemoryNotification
+    static constexpr uint64_t pal_features = LowMemoryNotification | Time |
+      Backtrace
 #  if defined(PLATFORM_HAS_VIRTUALALLOC2)
       | AlignedAllocation
 #  endif
@@ -105,6 +107,24 @@ namespace snmalloc
       low_memory_callbacks.register_notification(callback);
     }
 
+    /**
+     * Milliseconds since the system was started.
+     */
+    static uint64_t time_in_ms()
+    {
+      return GetTickCount64();
+    }
+
+    /**
+     * Fill `frames` with up to `depth` return addresses from the calling
+     * thread's stack.
+     */
+    static size_t capture_backtrace(void** frames, size_t depth)
+    {
+      return CaptureStackBackTrace(
+        0, static_cast<DWORD>(depth), frames, nullptr);
+    }
+
     static void error(const char* const str)
     {
       puts(str);
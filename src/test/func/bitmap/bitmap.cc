@@ -0,0 +1,96 @@
+#define USE_SLAB_BITMAP true
+#include <iostream>
+#include <snmalloc.h>
+#include <test/setup.h>
+#include <test/xoroshiro.h>
+#include <unordered_set>
+#include <vector>
+
+using namespace snmalloc;
+
+void check(bool cond, const char* msg)
+{
+  if (!cond)
+  {
+    std::cout << msg << std::endl;
+    abort();
+  }
+}
+
+/**
+ * Allocate `count` objects of `size` bytes, free a random half of them, and
+ * check that the slab bitmaps say which are free.  Then allocate as many
+ * again, and check that they come from each slab in address order.
+ */
+void test_bitmap(size_t size, size_t count)
+{
+  auto* a = ThreadAlloc::get();
+  xoroshiro::p128r64 r;
+  size_t rsize = sizeclass_to_size(size_to_sizeclass(size));
+
+  std::vector<void*> live;
+  std::vector<void*> freed;
+  for (size_t i = 0; i < count; i++)
+  {
+    auto* p = static_cast<char*>(a->alloc(size));
+    memset(p, 1, size);
+    check(Alloc::external_pointer(p + (rsize / 2)) == p, "Wrong start");
+    live.push_back(p);
+  }
+
+  for (size_t i = 0; i < live.size();)
+  {
+    if ((r.next() & 1) == 0)
+    {
+      i++;
+      continue;
+    }
+    a->dealloc(live[i], size);
+    freed.push_back(live[i]);
+    live[i] = live.back();
+    live.pop_back();
+  }
+
+  for (auto p : live)
+    check(!Metaslab::get_slab(p)->is_free(p), "Live object marked free");
+  for (auto p : freed)
+  {
+    auto* q = static_cast<char*>(p) + (rsize - 1);
+    check(Metaslab::get_slab(p)->is_free(q), "Freed object not marked free");
+  }
+
+  // Taking a slab's free objects returns its link object first and then the
+  // rest in address order, so there are at most two steps down in address
+  // for each slab.  A list in the order of the frees would have many more.
+  std::unordered_set<Slab*> slabs;
+  size_t steps_down = 0;
+  void* prev = nullptr;
+  for (size_t i = 0; i < count; i++)
+  {
+    void* p = a->alloc(size);
+    Slab* slab = Metaslab::get_slab(p);
+    if (!slabs.insert(slab).second && (Metaslab::get_slab(prev) == slab))
+    {
+      if (p < prev)
+        steps_down++;
+    }
+    prev = p;
+    live.push_back(p);
+  }
+  check(steps_down <= 2 * slabs.size(), "Free lists are not in order");
+
+  for (auto p : live)
+    a->dealloc(p, size);
+}
+
+int main()
+{
+  setup();
+
+  size_t sizes[] = {16, 48, 320, 1792, 5120, MAX_SMALL_SIZE};
+  for (size_t size : sizes)
+    test_bitmap(size, 4 * (SLAB_SIZE / size) + 7);
+
+  current_alloc_pool()->debug_check_empty();
+  return 0;
+}
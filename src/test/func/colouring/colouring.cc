@@ -0,0 +1,66 @@
+#define USE_SLAB_COLOURING true
+#include <iostream>
+#include <snmalloc.h>
+#include <test/setup.h>
+#include <unordered_set>
+#include <vector>
+
+using namespace snmalloc;
+
+void check(bool cond, const char* msg)
+{
+  if (!cond)
+  {
+    std::cout << msg << std::endl;
+    abort();
+  }
+}
+
+/**
+ * Fill `slabs` slabs with objects of `size` bytes.  Every object must map
+ * back to its own start and end, and the first objects of the slabs must
+ * be at more than one offset when the size class leaves room to colour.
+ */
+void test_colouring(size_t size, size_t slabs)
+{
+  auto* a = ThreadAlloc::get();
+  std::vector<void*> ptrs;
+  std::unordered_set<void*> seen;
+  std::unordered_set<size_t> first_offsets;
+  size_t rsize = sizeclass_to_size(size_to_sizeclass(size));
+
+  while (seen.size() < slabs)
+  {
+    auto* p = static_cast<char*>(a->alloc(size));
+    ptrs.push_back(p);
+    memset(p, 1, size);
+
+    Slab* slab = Metaslab::get_slab(p);
+    if (seen.insert(slab).second && !slab->is_short())
+      first_offsets.insert(pointer_diff(slab, p));
+
+    check(Alloc::alloc_size(p) == rsize, "Wrong size");
+    check(Alloc::external_pointer(p + (rsize / 2)) == p, "Wrong start");
+    check(Alloc::external_pointer<End>(p) == p + rsize - 1, "Wrong end");
+  }
+
+  size_t bitmap = SLAB_BITMAP ? slab_bitmap_words(rsize) * sizeof(size_t) : 0;
+  size_t leftover = (SLAB_SIZE - bitmap) % rsize;
+  if (leftover >= bits::max(CACHELINE_SIZE, size_t(1) << bits::ctz(rsize)))
+    check(first_offsets.size() > 1, "Slabs were not coloured");
+
+  for (auto p : ptrs)
+    a->dealloc(p, size);
+}
+
+int main()
+{
+  setup();
+
+  size_t sizes[] = {16, 48, 320, 1792, 2560, 5120, MAX_SMALL_SIZE};
+  for (size_t size : sizes)
+    test_colouring(size, 8);
+
+  current_alloc_pool()->debug_check_empty();
+  return 0;
+}
@@ -0,0 +1,96 @@
+#define USE_DECOMMIT_STRATEGY DecommitSuperDecay
+#define USE_DECOMMIT_DECAY_MS 10
+#include <chrono>
+#include <iostream>
+#include <snmalloc.h>
+#include <test/setup.h>
+#include <thread>
+#include <vector>
+
+using namespace snmalloc;
+
+/**
+ * Count the chunks in the large stack for `large_class` that are still
+ * committed, leaving the stack as it was.
+ */
+size_t count_committed(size_t large_class)
+{
+  auto& mp = default_memory_provider();
+  auto& stack = mp.large_stack[mp.numa_node()][large_class];
+  std::vector<Largeslab*> chunks;
+  size_t committed = 0;
+
+  while (Largeslab* slab = stack.pop())
+  {
+    if (slab->get_kind() != Decommitted)
+      committed++;
+    chunks.push_back(slab);
+  }
+
+  while (!chunks.empty())
+  {
+    stack.push(chunks.back());
+    chunks.pop_back();
+  }
+
+  return committed;
+}
+
+void check_zero(void* p, size_t size)
+{
+  auto* b = static_cast<uint8_t*>(p);
+  for (size_t i = 0; i < size; i += OS_PAGE_SIZE)
+  {
+    if (b[i] != 0)
+    {
+      std::cout << "Non-zero byte at offset " << i << std::endl;
+      abort();
+    }
+  }
+}
+
+int main()
+{
+  setup();
+
+  auto* a = ThreadAlloc::get();
+  size_t size = SUPERSLAB_SIZE * 2;
+  size_t large_class = bits::next_pow2_bits(size) - SUPERSLAB_BITS;
+
+  void* p = a->alloc(size);
+  memset(p, 0xff, size);
+  a->dealloc(p, size);
+
+  // Freeing does not decommit, the chunk is kept committed until it decays.
+  if (count_committed(large_class) != 1)
+  {
+    std::cout << "Freed chunk was decommitted eagerly" << std::endl;
+    abort();
+  }
+
+  // Reuse before decay must still honour zeroing.
+  p = a->alloc<YesZero>(size);
+  check_zero(p, size);
+  memset(p, 0xff, size);
+  a->dealloc(p, size);
+
+  std::this_thread::sleep_for(
+    std::chrono::milliseconds(4 * USE_DECOMMIT_DECAY_MS));
+
+  // Allocating a chunk of another class ticks the decay clock.
+  size_t other = SUPERSLAB_SIZE * 4;
+  void* q = a->alloc(other);
+  a->dealloc(q, other);
+
+  if (count_committed(large_class) != 0)
+  {
+    std::cout << "Idle chunk was not decommitted" << std::endl;
+    abort();
+  }
+
+  p = a->alloc<YesZero>(size);
+  check_zero(p, size);
+  a->dealloc(p, size);
+
+  return 0;
+}
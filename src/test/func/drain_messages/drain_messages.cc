@@ -0,0 +1,67 @@
+#define USE_REMOTE_SLOW_PATH_BATCH 64
+#include <iostream>
+#include <snmalloc.h>
+#include <test/setup.h>
+#include <vector>
+
+using namespace snmalloc;
+
+void check(bool condition, const char* message)
+{
+  if (!condition)
+  {
+    std::cout << message << std::endl;
+    abort();
+  }
+}
+
+int main()
+{
+  setup();
+
+  auto* pool = current_alloc_pool();
+  auto* a = pool->acquire();
+  auto* b = pool->acquire();
+
+  // Nothing to do on an empty queue.
+  check(a->drain_messages(100) == 0, "Drained messages from an empty queue");
+
+  // Free enough objects owned by `a` from `b` that `b` posts them to `a`.
+  size_t size = 64;
+  size_t count = (REMOTE_CACHE / size) * 2;
+  std::vector<void*> objects(count);
+
+  for (auto& p : objects)
+    p = a->alloc(size);
+
+  // Consecutive frees from one slab are sent as a single message, so free
+  // objects a slab apart to send each one as a message of its own.
+  size_t stride = SLAB_SIZE / size;
+  for (size_t offset = 0; offset < stride; offset++)
+  {
+    for (size_t i = offset; i < count; i += stride)
+      b->dealloc(objects[i], size);
+  }
+
+  check(a->has_messages(), "No messages were posted");
+
+  // An explicit drain handles exactly its budget.
+  check(a->drain_messages(100) == 100, "Drain did not use its budget");
+
+  // A slow path handles at most REMOTE_SLOW_PATH_BATCH messages.
+  size_t large = SUPERSLAB_SIZE * 2;
+  void* p = a->alloc(large);
+  check(a->has_messages(), "Slow path handled more than its budget");
+  a->dealloc(p, large);
+
+  // Draining without a bound empties the queue.
+  while (a->drain_messages(1000) != 0)
+  {
+  }
+  check(!a->has_messages(), "Drain left messages in the queue");
+
+  pool->release(a);
+  pool->release(b);
+  pool->debug_check_empty();
+  return 0;
+}
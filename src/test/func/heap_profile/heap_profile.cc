@@ -0,0 +1,103 @@
+#define SNMALLOC_HEAP_PROFILE
+#define USE_HEAP_PROFILE_INTERVAL (64 * 1024)
+#include <cmath>
+#include <iostream>
+#include <stdio.h>
+#include <string>
+#include <test/setup.h>
+#include <test/xoroshiro.h>
+#include <vector>
+
+#define SNMALLOC_NAME_MANGLE(a) our_##a
+#include "../../../override/malloc.cc"
+
+using namespace snmalloc;
+
+std::string dump()
+{
+  size_t length = our_snmalloc_heap_profile(nullptr, 0);
+  std::vector<char> buffer(length + 1);
+  size_t written = our_snmalloc_heap_profile(buffer.data(), buffer.size());
+  if (written != length)
+  {
+    std::cout << "Profile changed length between calls" << std::endl;
+    abort();
+  }
+  return std::string(buffer.data(), length);
+}
+
+/**
+ * Parse the live bytes from the header line of a profile.
+ */
+size_t live_bytes(const std::string& profile)
+{
+  size_t objects = 0;
+  size_t bytes = 0;
+  if (sscanf(profile.c_str(), "heap profile: %zu: %zu", &objects, &bytes) != 2)
+  {
+    std::cout << "Malformed profile header: " << profile.substr(0, 80)
+              << std::endl;
+    abort();
+  }
+  return bytes;
+}
+
+int main()
+{
+  setup();
+
+  // Allocate a mix of small, medium and large objects and keep them live.
+  xoroshiro::p128r64 r;
+  std::vector<void*> objects;
+  size_t actual = 0;
+
+  while (actual < 256 * 1024 * 1024)
+  {
+    size_t kind = r.next() % 1000;
+    size_t size;
+    if (kind < 990)
+      size = 16 + (r.next() % 2048);
+    else if (kind < 999)
+      size = SLAB_SIZE + (r.next() % (SUPERSLAB_SIZE / 8));
+    else
+      size = SUPERSLAB_SIZE + (r.next() % SUPERSLAB_SIZE);
+
+    void* p = our_malloc(size);
+    actual += our_malloc_usable_size(p);
+    objects.push_back(p);
+  }
+
+  std::string profile = dump();
+  size_t sampled = live_bytes(profile);
+  double error = std::abs(static_cast<double>(sampled) - actual) / actual;
+
+  std::cout << "Actual: " << actual << " bytes, sampled: " << sampled
+            << " bytes, error " << error * 100 << "%" << std::endl;
+
+  if (error > 0.1)
+  {
+    std::cout << "Sampled total is too far from the actual total" << std::endl;
+    abort();
+  }
+
+  if constexpr (pal_supports<Backtrace>)
+  {
+    if (profile.find(" @ 0x") == std::string::npos)
+    {
+      std::cout << "Samples have no stacks" << std::endl;
+      abort();
+    }
+  }
+
+  // Freeing every object retires every sample.
+  for (auto p : objects)
+    our_free(p);
+
+  if (live_bytes(dump()) != 0)
+  {
+    std::cout << "Freed objects are still in the profile" << std::endl;
+    abort();
+  }
+
+  return 0;
+}
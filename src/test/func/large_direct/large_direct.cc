@@ -0,0 +1,109 @@
+#define USE_LARGE_DIRECT_SIZE (SUPERSLAB_SIZE * 5)
+#include <iostream>
+#include <snmalloc.h>
+#include <test/setup.h>
+
+using namespace snmalloc;
+
+void check(bool cond, const char* msg)
+{
+  if (!cond)
+  {
+    std::cout << msg << std::endl;
+    abort();
+  }
+}
+
+/**
+ * Large allocations are a whole number of superslabs, and every superslab
+ * in them maps back to the start.
+ */
+void test_granularity()
+{
+  auto* a = ThreadAlloc::get();
+  for (size_t n = 1; n < 10; n++)
+  {
+    size_t size = (n == 1) ? SUPERSLAB_SIZE : (n * SUPERSLAB_SIZE) - 1;
+    auto* p = static_cast<char*>(a->alloc(size));
+    memset(p, 1, size);
+
+    check(Alloc::alloc_size(p) == n * SUPERSLAB_SIZE, "Wrong size");
+    for (size_t i = 0; i < n; i++)
+    {
+      char* q = p + (i * SUPERSLAB_SIZE);
+      check(Alloc::external_pointer(q) == p, "Wrong start");
+      check(
+        Alloc::external_pointer(q + SUPERSLAB_SIZE - 1) == p, "Wrong start");
+    }
+    check(
+      Alloc::external_pointer<End>(p) == p + (n * SUPERSLAB_SIZE) - 1,
+      "Wrong end");
+
+    a->dealloc(p);
+  }
+}
+
+/**
+ * The superslabs beyond a large allocation in its power of two chunk are
+ * free for other allocations, and for growing it in place.
+ */
+void test_tail_reuse()
+{
+  auto* a = ThreadAlloc::get();
+  auto* p = static_cast<char*>(a->alloc((SUPERSLAB_SIZE * 2) + 1));
+  check(Alloc::alloc_size(p) == SUPERSLAB_SIZE * 3, "Wrong size");
+
+  void* q = a->alloc(SUPERSLAB_SIZE);
+  check(q == p + (SUPERSLAB_SIZE * 3), "Tail was not reused");
+  check(!a->resize_large_in_place(p, SUPERSLAB_SIZE * 4), "Grew into use");
+  a->dealloc(q);
+
+  check(a->resize_large_in_place(p, SUPERSLAB_SIZE * 4), "Did not grow");
+  check(Alloc::alloc_size(p) == SUPERSLAB_SIZE * 4, "Wrong grown size");
+  memset(p, 1, SUPERSLAB_SIZE * 4);
+
+  check(a->resize_large_in_place(p, SUPERSLAB_SIZE + 1), "Did not shrink");
+  check(Alloc::alloc_size(p) == SUPERSLAB_SIZE * 2, "Wrong shrunk size");
+  a->dealloc(p);
+}
+
+/**
+ * Allocations of at least `LARGE_DIRECT_SIZE` are reserved from the platform
+ * for their exact size, and returned when freed.
+ */
+void test_direct()
+{
+  if constexpr (pal_supports<AddressRelease, GlobalVirtual>)
+  {
+    auto& mp = default_memory_provider();
+    auto* a = ThreadAlloc::get();
+    size_t size = SUPERSLAB_SIZE * 5;
+
+    size_t before = mp.reserved();
+    void* p = a->alloc(size);
+    check(mp.reserved() == before + size, "Not reserved directly");
+    memset(p, 1, size);
+    check(!a->resize_large_in_place(p, size * 2), "Resized a direct map");
+    a->dealloc(p);
+    check(mp.reserved() == before, "Not returned to the platform");
+
+    size_t alignment = SUPERSLAB_SIZE * 8;
+    p = a->alloc_aligned(alignment, size);
+    check(pointer_align_up(p, alignment) == p, "Not aligned");
+    check(Alloc::alloc_size(p) == size, "Wrong aligned size");
+    a->dealloc(p);
+    check(mp.reserved() == before, "Not returned to the platform");
+  }
+}
+
+int main()
+{
+  setup();
+
+  test_granularity();
+  test_tail_reuse();
+  test_direct();
+
+  current_alloc_pool()->debug_check_empty();
+  return 0;
+}
@@ -0,0 +1,191 @@
+#include <iostream>
+#include <test/setup.h>
+#include <thread>
+#include <vector>
+
+#define SNMALLOC_NAME_MANGLE(a) our_##a
+#include "../../../override/malloc.cc"
+
+using namespace snmalloc;
+
+void check(bool condition, const char* message)
+{
+  if (!condition)
+  {
+    std::cout << message << std::endl;
+    abort();
+  }
+}
+
+size_t read_size(const char* name)
+{
+  size_t value = 0;
+  size_t length = sizeof(value);
+  if (our_mallctl(name, &value, &length, nullptr, 0) != 0)
+  {
+    std::cout << "Failed to read " << name << std::endl;
+    abort();
+  }
+  return value;
+}
+
+void refresh()
+{
+  uint64_t epoch = 1;
+  size_t length = sizeof(epoch);
+  check(
+    our_mallctl("epoch", &epoch, &length, &epoch, sizeof(epoch)) == 0,
+    "Failed to refresh epoch");
+}
+
+void test_errors()
+{
+  size_t value = 0;
+  size_t length = sizeof(value);
+  check(
+    our_mallctl("stats.nonsense", &value, &length, nullptr, 0) == ENOENT,
+    "Unknown name found");
+  check(
+    our_mallctl("stats.allocated", &value, &length, &value, length) == EPERM,
+    "Wrote a read-only value");
+
+  uint32_t small = 0;
+  length = sizeof(small);
+  check(
+    our_mallctl("stats.allocated", &small, &length, nullptr, 0) == EINVAL,
+    "Read into a buffer of the wrong size");
+  check(
+    our_mallctl("arenas.bin.100000.size", &value, &length, nullptr, 0) ==
+      ENOENT,
+    "Read an out of range size class");
+}
+
+void test_sizeclass_counts()
+{
+  size_t size = 100;
+  size_t count = 1000;
+  sizeclass_t sizeclass = size_to_sizeclass(size);
+  size_t rsize = sizeclass_to_size(sizeclass);
+
+  unsigned nbins = 0;
+  size_t length = sizeof(nbins);
+  check(
+    our_mallctl("arenas.nbins", &nbins, &length, nullptr, 0) == 0,
+    "Failed to read arenas.nbins");
+  check(nbins == NUM_SIZECLASSES, "Wrong number of bins");
+
+  std::string bin = "arenas.bin." + std::to_string(sizeclass) + ".size";
+  check(read_size(bin.c_str()) == rsize, "Wrong bin size");
+
+  std::string curregs =
+    "stats.arenas.0.bins." + std::to_string(sizeclass) + ".curregs";
+
+  refresh();
+  size_t allocated = read_size("stats.allocated");
+  size_t regs = read_size(curregs.c_str());
+
+  std::vector<void*> objects(count);
+  for (auto& p : objects)
+    p = our_malloc(size);
+
+  refresh();
+  check(
+    read_size("stats.allocated") - allocated == count * rsize,
+    "stats.allocated did not count the new objects");
+  check(
+    read_size(curregs.c_str()) - regs == count,
+    "curregs did not count the new objects");
+  check(
+    read_size("stats.active") >= read_size("stats.allocated"),
+    "More bytes allocated than active");
+  check(
+    read_size("stats.mapped") >= read_size("stats.active"),
+    "More bytes active than mapped");
+
+  for (auto p : objects)
+    our_free(p);
+
+  refresh();
+  check(
+    read_size("stats.allocated") == allocated,
+    "stats.allocated did not count the freed objects");
+  check(
+    read_size(curregs.c_str()) == regs,
+    "curregs did not count the freed objects");
+}
+
+void test_large()
+{
+  size_t size = SUPERSLAB_SIZE * 2;
+  std::string curlextents = "stats.arenas.4096.lextents.1.curlextents";
+  check(
+    read_size("arenas.lextent.1.size") == size, "Wrong large extent size");
+
+  size_t before = read_size(curlextents.c_str());
+  void* p = our_malloc(size);
+  check(
+    read_size(curlextents.c_str()) == before + 1,
+    "Large allocation not counted");
+
+  size_t active = read_size("stats.active");
+  our_free(p);
+  check(
+    read_size(curlextents.c_str()) == before, "Large free not counted");
+  check(
+    active - read_size("stats.active") == size,
+    "Large free did not reduce stats.active");
+}
+
+void test_actions()
+{
+  // Free objects allocated by another thread, so that they sit in this
+  // thread's remote cache until it is flushed.
+  std::vector<void*> objects(100);
+  std::thread([&]() {
+    for (auto& p : objects)
+      p = our_malloc(64);
+  }).join();
+
+  for (auto p : objects)
+    our_free(p);
+
+  size_t value = 0;
+  size_t length = sizeof(value);
+  check(
+    our_mallctl("thread.flush", &value, &length, nullptr, 0) == EPERM,
+    "Read from an action");
+  check(
+    our_mallctl("thread.flush", nullptr, nullptr, nullptr, 0) == 0,
+    "thread.flush failed");
+
+  // Purging keeps the address space, so the total of mapped and retained
+  // does not change, but retained cannot shrink.
+  size_t total = read_size("stats.mapped") + read_size("stats.retained");
+  size_t retained = read_size("stats.retained");
+  check(
+    our_mallctl("arena.purge", nullptr, nullptr, nullptr, 0) == 0,
+    "arena.purge failed");
+  check(
+    our_mallctl("arena.4096.purge", nullptr, nullptr, nullptr, 0) == 0,
+    "arena.4096.purge failed");
+  check(read_size("stats.retained") >= retained, "Purge reduced retained");
+  check(
+    read_size("stats.mapped") + read_size("stats.retained") == total,
+    "Purge changed the reserved address space");
+}
+
+int main()
+{
+  setup();
+
+  // Initialise this thread's allocator, which allocates internally, so that
+  // the counts below only see the test's objects.
+  our_free(our_malloc(1));
+
+  test_errors();
+  test_sizeclass_counts();
+  test_large();
+  test_actions();
+
+  return 0;
+}
@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <test/setup.h>
+#include <thread>
+#include <vector>
 
 #define SNMALLOC_NAME_MANGLE(a) our_##a
 #include "../../../override/malloc.cc"
@@ -56,6 +58,93 @@ void test_realloc(void* p, size_t size, int err, bool null)
   check_result(size, 1, new_p, err, null);
 }
 
+/**
+ * Grow an allocation from `from` to `size` bytes within its sizeclass,
+ * after the slot it uses has been freed once, and write to all of it.
+ */
+void test_realloc_in_class(size_t from, size_t size)
+{
+  fprintf(stderr, "realloc(%d, %d) in class\n", (int)from, (int)size);
+  void* keep = our_malloc(size);
+  our_free(our_malloc(size));
+
+  void* p = our_malloc(from);
+  memset(p, 0xab, from);
+  p = our_realloc(p, size);
+  if (p == nullptr)
+    abort();
+  memset(p, 0xcd, size);
+  our_free(p);
+  our_free(keep);
+}
+
+/**
+ * Allocate `from` bytes in a slot of a larger sizeclass that has been freed
+ * once, and write to all of its usable size.
+ */
+void test_usable_in_class(size_t from)
+{
+  fprintf(stderr, "malloc_usable_size(malloc(%d)) in class\n", (int)from);
+  size_t size = sizeclass_to_size(size_to_sizeclass(from));
+  void* keep = our_malloc(size);
+  our_free(our_malloc(size));
+
+  void* p = our_malloc(from);
+  if (p == nullptr)
+    abort();
+  size_t usable = our_malloc_usable_size(p);
+  if (usable < size)
+    abort();
+  memset(p, 0xcd, usable);
+  our_free(p);
+  our_free(keep);
+}
+
+/**
+ * Shrink large allocations in place on some threads while the others
+ * allocate the chunks that shrinking returns, and check that every
+ * allocation keeps its size in the chunkmap.
+ */
+void test_realloc_shrink_concurrent()
+{
+  fprintf(stderr, "concurrent realloc shrink\n");
+  constexpr size_t threads = 4;
+  constexpr size_t rounds = 200;
+  const size_t sizes[] = {SUPERSLAB_SIZE, SUPERSLAB_SIZE * 2, 4096, 300000};
+
+  std::vector<std::thread> t;
+  for (size_t i = 0; i < threads; i++)
+  {
+    t.emplace_back([i, &sizes]() {
+      for (size_t r = 0; r < rounds; r++)
+      {
+        if (i % 2 == 0)
+        {
+          void* p = our_malloc(SUPERSLAB_SIZE * 4);
+          p = our_realloc(p, SUPERSLAB_SIZE + 1);
+          if ((p == nullptr) || (our_malloc_usable_size(p) < SUPERSLAB_SIZE))
+            abort();
+          our_free(p);
+          continue;
+        }
+
+        void* q[4];
+        for (size_t j = 0; j < 4; j++)
+          q[j] = our_malloc(sizes[j]);
+        for (size_t j = 0; j < 4; j++)
+        {
+          if (our_malloc_usable_size(q[j]) < sizes[j])
+            abort();
+          our_free(q[j]);
+        }
+      }
+    });
+  }
+
+  for (auto& thread : t)
+    thread.join();
+}
+
 void test_posix_memalign(size_t size, size_t align, int err, bool null)
 {
   fprintf(stderr, "posix_memalign(&p, %d, %d)\n", (int)align, (int)size);
@@ -72,6 +161,29 @@ void test_memalign(size_t size, size_t align, int err, bool null)
   check_result(size, align, p, err, null);
 }
 
+void test_batch(size_t size, size_t n)
+{
+  fprintf(stderr, "alloc_batch(%d, %d)\n", (int)size, (int)n);
+  void* ptrs[512];
+  SNMALLOC_ASSERT(n <= 512);
+  if (our_snmalloc_alloc_batch(size, ptrs, n) != n)
+    abort();
+
+  for (size_t i = 0; i < n; i++)
+  {
+    if (our_malloc_usable_size(ptrs[i]) < size)
+      abort();
+    memset(ptrs[i], 0xab, size);
+  }
+
+  // Free half individually so the batch free sees a mix of runs.
+  for (size_t i = 0; i < n; i += 2)
+    our_free(ptrs[i]);
+  for (size_t i = 1; i < n; i += 2)
+    ptrs[i / 2] = ptrs[i];
+  our_snmalloc_dealloc_batch(ptrs, n / 2, size);
+}
+
 int main(int argc, char** argv)
 {
   UNUSED(argc);
@@ -102,8 +214,19 @@ int main(int argc, char** argv)
     test_realloc(our_malloc(size), 0, SUCCESS, true);
     test_realloc(nullptr, size, SUCCESS, false);
     test_realloc(our_malloc(size), (size_t)-1, ENOMEM, true);
+
+    if (sc >= NUM_SMALL_CLASSES)
+    {
+      test_realloc_in_class(size - OS_PAGE_SIZE, size);
+      test_usable_in_class(size - OS_PAGE_SIZE);
+    }
+
+    test_batch(size, 1);
+    test_batch(size, bits::min<size_t>(512, SUPERSLAB_SIZE / size));
   }
 
+  test_realloc_shrink_concurrent();
+
   test_posix_memalign(0, 0, EINVAL, true);
   test_posix_memalign((size_t)-1, 0, EINVAL, true);
   test_posix_memalign(OS_PAGE_SIZE, sizeof(uintptr_t) / 2, EINVAL, true);
@@ -119,6 +242,7 @@ int main(int argc, char** argv)
       test_memalign(size, align, SUCCESS, false);
     }
     test_posix_memalign(0, align, SUCCESS, false);
+    test_posix_memalign(SUPERSLAB_SIZE * 3, align, SUCCESS, false);
     test_posix_memalign((size_t)-1, align, ENOMEM, true);
     test_posix_memalign(0, align + 1, EINVAL, true);
   }
@@ -201,8 +201,11 @@ void check_external_pointer_large(size_t* base)
   char* curr = (char*)base;
   for (size_t offset = 0; offset < size; offset += 1 << 24)
   {
+    // Large allocations are a whole number of superslabs, not a power of
+    // two, so the last step may be short.
+    size_t step = snmalloc::bits::min<size_t>(1 << 24, size - offset);
     check_offset(base, (void*)(curr + offset));
-    check_offset(base, (void*)(curr + offset + (1 << 24) - 1));
+    check_offset(base, (void*)(curr + offset + step - 1));
   }
 }
 
@@ -6,7 +6,8 @@ using namespace snmalloc;
 // Check for all sizeclass that we correctly round every offset within
 // a superslab to the correct value, by comparing with the standard
 // unoptimised version using division.
-// Also check we correctly determine multiples using optimized check.
+// Also check we correctly determine multiples using optimized check, and
+// divide using the optimized division.
 
 int main(int argc, char** argv)
 {
@@ -30,6 +31,9 @@ int main(int argc, char** argv)
       bool opt_mod_0 = is_multiple_of_sizeclass(rsize, offset);
       if (opt_mod_0 != mod_0)
         abort();
+
+      if (divide_by_sizeclass(rsize, offset) != (offset / rsize))
+        abort();
     }
   }
   return 0;
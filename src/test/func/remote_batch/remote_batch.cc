@@ -0,0 +1,136 @@
+#include <iostream>
+#include <snmalloc.h>
+#include <test/setup.h>
+#include <unordered_set>
+#include <vector>
+
+using namespace snmalloc;
+
+void check(bool condition, const char* message)
+{
+  if (!condition)
+  {
+    std::cout << message << std::endl;
+    abort();
+  }
+}
+
+/**
+ * Handle all of `a`'s messages, and return how many there were.
+ */
+template<typename A>
+size_t drain(A* a)
+{
+  size_t total = 0;
+  for (size_t n = a->drain_messages(1000); n != 0;
+       n = a->drain_messages(1000))
+    total += n;
+  return total;
+}
+
+/**
+ * Allocate `count` objects of `size` bytes from `a` and free them from `b`,
+ * skipping every `keep`th object if `keep` is not zero.  Frees from the same
+ * slab are sent together, so `a` must receive far fewer messages than there
+ * were objects.  The objects kept are returned.
+ */
+template<typename A>
+std::vector<void*>
+test_batch(A* a, A* b, size_t size, size_t count, size_t keep, bool sized)
+{
+  std::vector<void*> objects(count);
+  std::vector<void*> kept;
+  for (auto& p : objects)
+  {
+    p = a->alloc(size);
+    memset(p, 1, size);
+  }
+
+  size_t freed = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    if ((keep != 0) && ((i % keep) == 0))
+    {
+      kept.push_back(objects[i]);
+      continue;
+    }
+
+    if (sized)
+      b->dealloc(objects[i], size);
+    else
+      b->dealloc(objects[i]);
+    freed++;
+  }
+
+  // Send everything cached by `b`.
+  b->flush_remote_cache();
+  size_t messages = drain(a);
+  check(messages > 0, "No messages were received");
+  check(messages < freed / 4, "Remote frees were not batched");
+
+  // The freed objects are available to `a` again.
+  for (size_t i = 0; i < freed; i++)
+    kept.push_back(a->alloc(size));
+
+  return kept;
+}
+
+/**
+ * Allocate `count` objects of `size` bytes from `a`, and free them from the
+ * `senders` between them, so that `a` receives messages for the same slabs
+ * from each sender and gathers them together.  Every object must then be
+ * allocated again exactly once.
+ */
+template<typename A>
+void test_gather(A* a, std::vector<A*>& senders, size_t size, size_t count)
+{
+  std::vector<void*> objects(count);
+  for (auto& p : objects)
+    p = a->alloc(size);
+
+  for (size_t i = 0; i < count; i++)
+    senders[i % senders.size()]->dealloc(objects[i]);
+  for (auto s : senders)
+    s->flush_remote_cache();
+  drain(a);
+
+  std::unordered_set<void*> seen;
+  for (auto& p : objects)
+  {
+    p = a->alloc(size);
+    check(seen.insert(p).second, "Object allocated twice");
+  }
+
+  for (auto p : objects)
+    a->dealloc(p, size);
+}
+
+int main()
+{
+  setup();
+
+  auto* pool = current_alloc_pool();
+  auto* a = pool->acquire();
+  auto* b = pool->acquire();
+
+  for (size_t size : {16, 48, 256, 1024})
+  {
+    size_t count = 4 * (SLAB_SIZE / size) + 3;
+    std::vector<void*> all = test_batch(a, b, size, count, 0, true);
+    std::vector<void*> some = test_batch(a, b, size, count, 3, false);
+    for (auto p : all)
+      a->dealloc(p, size);
+    for (auto p : some)
+      a->dealloc(p, size);
+  }
+
+  std::vector<decltype(a)> senders = {b, pool->acquire(), pool->acquire()};
+  for (size_t size : {16, 48, 256, 1024})
+    test_gather(a, senders, size, 3 * (SLAB_SIZE / size) + 5);
+
+  pool->release(a);
+  for (auto s : senders)
+    pool->release(s);
+  pool->debug_check_empty();
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <snmalloc.h>
+#include <test/setup.h>
+#include <vector>
+
+using namespace snmalloc;
+
+void check(bool condition, const char* message)
+{
+  if (!condition)
+  {
+    std::cout << message << std::endl;
+    abort();
+  }
+}
+
+int main()
+{
+  setup();
+
+  auto* pool = current_alloc_pool();
+  auto* a = pool->acquire();
+  auto* b = pool->acquire();
+
+  check(
+    b->get_remote_cache_size() == REMOTE_CACHE,
+    "Remote cache should start at its maximum size");
+
+  // Free objects owned by `a` from `b`, so every post from `b` sends a
+  // single batch to a single target.  The cache should shrink towards the
+  // size needed for that batch.
+  size_t size = 64;
+  size_t count = (REMOTE_CACHE / size) * 4;
+  std::vector<void*> objects(count);
+
+  for (auto& p : objects)
+    p = a->alloc(size);
+
+  for (auto p : objects)
+    b->dealloc(p, size);
+
+  check(
+    b->get_remote_cache_size() < REMOTE_CACHE,
+    "Remote cache did not shrink for a single target");
+  check(
+    b->get_remote_cache_size() >= REMOTE_CACHE_MIN,
+    "Remote cache shrank below its minimum size");
+
+  // A congested target makes the cache grow again.  The flag is set after
+  // allocating, as `a` updates it whenever it handles its message queue.
+  int64_t shrunk = b->get_remote_cache_size();
+
+  for (auto& p : objects)
+    p = a->alloc(size);
+
+  RemoteAllocator* target = Superslab::get(objects[0])->get_allocator();
+  target->set_congested(true);
+
+  for (auto p : objects)
+    b->dealloc(p, size);
+
+  check(
+    b->get_remote_cache_size() > shrunk,
+    "Remote cache did not grow for a congested target");
+
+  target->set_congested(false);
+
+  pool->release(a);
+  pool->release(b);
+  pool->debug_check_empty();
+  return 0;
+}
@@ -0,0 +1,100 @@
+#include <iostream>
+#include <snmalloc.h>
+#include <test/setup.h>
+#include <unordered_set>
+#include <vector>
+
+using namespace snmalloc;
+
+void check(bool condition, const char* message)
+{
+  if (!condition)
+  {
+    std::cout << message << std::endl;
+    abort();
+  }
+}
+
+/**
+ * Handle all of `a`'s messages.
+ */
+template<typename A>
+void drain(A* a)
+{
+  while (a->drain_messages() != 0)
+  {
+  }
+}
+
+/**
+ * Allocate `count` objects of `size` bytes from `a`, free them from the
+ * `senders` between them, and check that `a` gets every object back exactly
+ * once.
+ */
+template<typename A>
+void test_frees(A* a, std::vector<A*>& senders, size_t size, size_t count)
+{
+  std::vector<void*> objects(count);
+  for (auto& p : objects)
+    p = a->alloc(size);
+
+  for (size_t i = 0; i < count; i++)
+    senders[i % senders.size()]->dealloc(objects[i]);
+  for (auto s : senders)
+    s->flush_remote_cache();
+  drain(a);
+
+  std::unordered_set<void*> seen;
+  for (auto& p : objects)
+  {
+    p = a->alloc(size);
+    check(seen.insert(p).second, "Object allocated twice");
+  }
+
+  for (auto p : objects)
+    a->dealloc(p, size);
+}
+
+int main()
+{
+  setup();
+
+  auto* pool = current_alloc_pool();
+  auto* a = pool->acquire();
+  std::vector<decltype(a)> senders;
+  for (size_t i = 0; i < 2 * REMOTE_LANES + 1; i++)
+    senders.push_back(pool->acquire());
+
+  // Without contention, everything goes through the one queue.
+  void* p = a->alloc(16);
+  RemoteAllocator* target = Superslab::get(p)->get_allocator();
+  senders[0]->dealloc(p);
+  senders[0]->flush_remote_cache();
+  drain(a);
+  check(target->lanes.load() == nullptr, "Lanes added without contention");
+
+  for (size_t size : {16, 256, 4096, 20000})
+    test_frees(a, senders, size, 1000);
+
+  // Report contention, as many senders at once would.  The lanes are added
+  // the next time the owner handles its messages.
+  for (size_t i = 0; i < REMOTE_LANE_CONTENTION; i++)
+    target->record_contention();
+
+  p = a->alloc(16);
+  senders[1]->dealloc(p);
+  senders[1]->flush_remote_cache();
+  drain(a);
+  check(
+    (target->lanes.load() != nullptr) == (REMOTE_LANES > 1),
+    "Lanes not added after contention");
+
+  for (size_t size : {16, 256, 4096, 20000})
+    test_frees(a, senders, size, 1000);
+
+  pool->release(a);
+  for (auto s : senders)
+    pool->release(s);
+  pool->debug_check_empty();
+  return 0;
+}
@@ -0,0 +1,67 @@
+#include <snmalloc.h>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <vector>
+
+using namespace snmalloc;
+
+/**
+ * Allocate and free `count` objects of `size` bytes in batches of `batch`,
+ * either one object at a time through the thread-local allocator (as malloc
+ * would) or through the batch API.
+ */
+template<bool use_batch>
+void test_batch(size_t count, size_t size, size_t batch)
+{
+  std::vector<void*> ptrs(batch);
+
+  DO_TIME(
+    (use_batch ? "alloc_batch" : "alloc loop ") << " Size: " << std::setw(5)
+                                                << size << ", Batch: "
+                                                << std::setw(4) << batch,
+    {
+      for (size_t done = 0; done < count; done += batch)
+      {
+        if constexpr (use_batch)
+        {
+          auto* a = ThreadAlloc::get_noncachable();
+          if (a->alloc_batch(size, ptrs.data(), batch) != batch)
+            abort();
+          for (auto p : ptrs)
+            *static_cast<size_t*>(p) = size;
+          a->dealloc_batch(ptrs.data(), batch, size);
+        }
+        else
+        {
+          for (auto& p : ptrs)
+          {
+            p = ThreadAlloc::get_noncachable()->alloc(size);
+            *static_cast<size_t*>(p) = size;
+          }
+          for (auto p : ptrs)
+            ThreadAlloc::get_noncachable()->dealloc(p, size);
+        }
+      }
+    });
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t count = opt.is<size_t>("--count", 1 << 20);
+
+  for (size_t size = 16; size <= 256; size <<= 2)
+  {
+    for (size_t batch = 16; batch <= 1024; batch <<= 3)
+    {
+      test_batch<false>(count, size, batch);
+      test_batch<true>(count, size, batch);
+    }
+  }
+
+  current_alloc_pool()->debug_check_empty();
+  return 0;
+}
@@ -0,0 +1,93 @@
+#include <snmalloc.h>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <unordered_map>
+#include <vector>
+
+using namespace snmalloc;
+
+/**
+ * Allocate objects of `size` bytes until `count` slabs have been started,
+ * keep the first object of each slab and free the rest.  Without colouring
+ * the objects kept are all at the same offset in their slabs.
+ */
+std::vector<void*> first_per_slab(size_t size, size_t count)
+{
+  auto* a = ThreadAlloc::get();
+  std::unordered_map<void*, void*> first;
+  std::vector<void*> rest;
+
+  while (first.size() < count)
+  {
+    void* p = a->alloc(size);
+    auto [it, inserted] = first.emplace(Metaslab::get_slab(p), p);
+    if (!inserted)
+    {
+      if (p < it->second)
+        std::swap(p, it->second);
+      rest.push_back(p);
+    }
+  }
+
+  for (auto p : rest)
+    a->dealloc(p, size);
+
+  std::vector<void*> result;
+  for (auto& e : first)
+    result.push_back(e.second);
+  return result;
+}
+
+/**
+ * Repeatedly read the first word of the first object in each of `count`
+ * slabs of `size` byte objects, as when walking a structure whose nodes were
+ * allocated far apart, and report the time taken.
+ */
+void test_walk(size_t size, size_t count, size_t rounds)
+{
+  auto* a = ThreadAlloc::get();
+  std::vector<void*> ptrs = first_per_slab(size, count);
+
+  std::unordered_map<size_t, size_t> offsets;
+  for (auto p : ptrs)
+  {
+    *static_cast<size_t*>(p) = 1;
+    offsets[pointer_diff(Metaslab::get_slab(p), p)]++;
+  }
+
+  size_t sum = 0;
+  DO_TIME(
+    "Walk " << size << " byte objects in " << count << " slabs at "
+            << offsets.size() << " offsets",
+    {
+      for (size_t r = 0; r < rounds; r++)
+      {
+        for (auto p : ptrs)
+          sum += *static_cast<volatile size_t*>(p);
+      }
+    });
+
+  if (sum != rounds * count)
+    abort();
+
+  for (auto p : ptrs)
+    a->dealloc(p, size);
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t count = opt.is<size_t>("--count", 256);
+  size_t rounds = opt.is<size_t>("--rounds", 1000);
+
+  std::cout << "Slab colouring is " << (SLAB_COLOURING ? "on" : "off")
+            << std::endl;
+
+  for (size_t size : {320, 1792, 2560, 5120})
+    test_walk(size, count, rounds);
+
+  return 0;
+}
@@ -147,6 +147,60 @@ void test_tasks(size_t num_tasks, size_t count, size_t size)
 #endif
 };
 
+size_t churncount;
+
+void test_large_churn_f(size_t id)
+{
+  Alloc* a = ThreadAlloc::get();
+  xoroshiro::p128r32 r(id + 5000);
+
+  // Each thread replaces a few live objects in turn, with sizes from a
+  // medium slab up to a few superslabs.
+  static constexpr size_t live_count = 4;
+  void* live[live_count] = {};
+  size_t live_size[live_count] = {};
+
+  for (size_t n = 0; n < churncount; n++)
+  {
+    size_t slot = n % live_count;
+    if (live[slot] != nullptr)
+    {
+      if (use_malloc)
+        free(live[slot]);
+      else
+        a->dealloc(live[slot], live_size[slot]);
+    }
+
+    size_t size = (SUPERSLAB_SIZE / 4) << (r.next() % 5);
+    live[slot] = use_malloc ? malloc(size) : a->alloc(size);
+    *static_cast<char*>(live[slot]) = 1;
+    live_size[slot] = size;
+  }
+
+  for (size_t slot = 0; slot < live_count; slot++)
+  {
+    if (use_malloc)
+      free(live[slot]);
+    else
+      a->dealloc(live[slot], live_size[slot]);
+  }
+};
+
+void test_large_churn(size_t num_tasks, size_t count)
+{
+  churncount = count;
+
+  ParallelTest<test_large_churn_f> test(num_tasks);
+
+  std::cout << "Large churn test, " << num_tasks << " threads, " << count
+            << " allocations per thread " << test.time() << "ticks"
+            << std::endl;
+
+#ifndef NDEBUG
+  current_alloc_pool()->debug_check_empty();
+#endif
+};
+
 int main(int argc, char** argv)
 {
   setup();
@@ -156,6 +210,7 @@ int main(int argc, char** argv)
 
   size_t count = opt.is<size_t>("--swapcount", 1 << 20);
   size_t size = opt.is<size_t>("--swapsize", 1 << 18);
+  size_t churn = opt.is<size_t>("--churncount", 1 << 14);
   use_malloc = opt.has("--use_malloc");
 
   std::cout << "Allocator is " << (use_malloc ? "System" : "snmalloc")
@@ -164,6 +219,9 @@ int main(int argc, char** argv)
   for (size_t i = cores; i > 0; i >>= 1)
     test_tasks(i, count, size);
 
+  for (size_t i = cores; i > 0; i >>= 1)
+    test_large_churn(i, churn);
+
   if (opt.has("--stats"))
   {
 #ifdef USE_SNMALLOC_STATS
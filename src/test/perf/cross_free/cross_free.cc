@@ -0,0 +1,82 @@
+#include <iostream>
+#include <snmalloc.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <thread>
+#include <vector>
+
+using namespace snmalloc;
+
+/**
+ * Each of `threads` threads allocates `count` small objects, and then they
+ * all free, with the unsized `dealloc`, either their own objects or those of
+ * the next thread, while that thread frees into the same superslabs.
+ * Reports the ticks per free, which includes finding the owner and size
+ * class of each object.
+ */
+void test_free(size_t threads, size_t count, size_t rounds, bool cross)
+{
+  std::vector<std::vector<void*>> ptrs(threads);
+  std::atomic<size_t> arrived = 0;
+  std::atomic<uint64_t> ticks = 0;
+
+  auto run = [&](size_t id) {
+    auto* a = ThreadAlloc::get();
+    size_t phase = 0;
+    auto barrier = [&]() {
+      phase++;
+      arrived++;
+      while (arrived < threads * phase)
+        std::this_thread::yield();
+    };
+
+    for (size_t r = 0; r < rounds; r++)
+    {
+      auto& mine = ptrs[id];
+      for (size_t i = 0; i < count; i++)
+        mine.push_back(a->alloc(16 << (i % 8)));
+      barrier();
+
+      auto& victim = ptrs[cross ? (id + 1) % threads : id];
+      uint64_t start = Aal::tick();
+      for (auto p : victim)
+        a->dealloc(p);
+      ticks += Aal::tick() - start;
+      barrier();
+
+      victim.clear();
+      barrier();
+    }
+  };
+
+  std::vector<std::thread> t;
+  for (size_t i = 0; i < threads; i++)
+    t.emplace_back(run, i);
+  for (auto& thread : t)
+    thread.join();
+
+  size_t frees = threads * count * rounds;
+  std::cout << (cross ? "Cross-thread" : "Local") << " free, " << threads
+            << " threads, " << (ticks / frees) << " ticks per free"
+            << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t cores = opt.is<size_t>("--cores", 8);
+  size_t count = opt.is<size_t>("--count", 1 << 14);
+  size_t rounds = opt.is<size_t>("--rounds", 16);
+
+  for (size_t i = 1; i <= cores; i <<= 1)
+  {
+    test_free(i, count, rounds, false);
+    if (i > 1)
+      test_free(i, count, rounds, true);
+  }
+
+  current_alloc_pool()->debug_check_empty();
+  return 0;
+}
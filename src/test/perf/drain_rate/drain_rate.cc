@@ -0,0 +1,77 @@
+#include <chrono>
+#include <iostream>
+#include <snmalloc.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <test/xoroshiro.h>
+#include <vector>
+
+using namespace snmalloc;
+
+void shuffle(std::vector<void*>& ptrs, xoroshiro::p128r64& r)
+{
+  for (size_t i = ptrs.size(); i > 1; i--)
+    std::swap(ptrs[i - 1], ptrs[r.next() % i]);
+}
+
+/**
+ * The owner allocates `count` objects of `size` bytes, and `senders` other
+ * allocators free them between them, in a random order or in the order they
+ * were allocated, and send the frees back.  Reports the rate at which the
+ * owner handles the frees waiting in its queue.
+ */
+void test_drain(size_t size, size_t count, size_t senders, bool random)
+{
+  auto* pool = current_alloc_pool();
+  auto* owner = pool->acquire();
+  std::vector<Alloc*> sender(senders);
+  for (auto& s : sender)
+    s = pool->acquire();
+
+  xoroshiro::p128r64 r;
+  std::vector<void*> ptrs(count);
+  for (auto& p : ptrs)
+    p = owner->alloc(size);
+  if (random)
+    shuffle(ptrs, r);
+
+  for (size_t i = 0; i < count; i++)
+    sender[i % senders]->dealloc(ptrs[i]);
+  for (auto s : sender)
+    s->flush_remote_cache();
+
+  auto start = std::chrono::high_resolution_clock::now();
+  while (owner->drain_messages() != 0)
+  {
+  }
+  auto finish = std::chrono::high_resolution_clock::now();
+
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+              finish - start)
+              .count();
+  std::cout << "Drain " << count << " " << size << " byte frees from "
+            << senders << " senders in " << (random ? "random" : "allocation")
+            << " order: " << (double(count) * 1000 / double(ns))
+            << " million frees per second" << std::endl;
+
+  for (auto s : sender)
+    pool->release(s);
+  pool->release(owner);
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t count = opt.is<size_t>("--count", 1 << 20);
+  size_t senders = opt.is<size_t>("--senders", 4);
+
+  for (size_t size : {16, 64, 256})
+  {
+    test_drain(size, count, senders, true);
+    test_drain(size, count, senders, false);
+  }
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include <fstream>
+#include <iostream>
+#include <snmalloc.h>
+#include <string>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <test/xoroshiro.h>
+#include <vector>
+
+using namespace snmalloc;
+
+/**
+ * Report the amount of anonymous memory backed by transparent huge pages,
+ * or 0 if this cannot be determined on this platform.
+ */
+size_t anon_huge_pages_kb()
+{
+  std::ifstream smaps("/proc/self/smaps_rollup");
+  std::string key;
+  while (smaps >> key)
+  {
+    if (key == "AnonHugePages:")
+    {
+      size_t kb;
+      smaps >> kb;
+      return kb;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Allocate many small objects from a memory provider with the given huge page
+ * policy and then touch them in a random order, which is dominated by TLB
+ * misses when the heap is backed by base pages.
+ */
+void test_random_access(
+  size_t huge_page_classes, size_t count, size_t size, size_t accesses)
+{
+  auto* mp = GlobalVirtual::make();
+  mp->huge_page_classes = huge_page_classes;
+  auto* pool = make_alloc_pool(*mp);
+  auto* alloc = pool->acquire();
+
+  std::vector<size_t*> objects(count);
+  for (auto& p : objects)
+  {
+    p = static_cast<size_t*>(alloc->alloc(size));
+    *p = 1;
+  }
+
+  size_t before = anon_huge_pages_kb();
+  xoroshiro::p128r64 r;
+  size_t sum = 0;
+
+  DO_TIME(
+    "Huge page classes: " << huge_page_classes << ", Objects: " << count
+                          << ", Size: " << size << ", Accesses: " << accesses,
+    {
+      for (size_t i = 0; i < accesses; i++)
+      {
+        size_t* p = objects[r.next() % count];
+        sum += *p;
+        *p = i;
+      }
+    });
+
+  std::cout << "AnonHugePages: " << before << " KiB" << std::endl;
+
+  // Prevent the access loop being optimised away.
+  if (sum == 0)
+    abort();
+
+  for (auto p : objects)
+    alloc->dealloc(p, size);
+
+  pool->release(alloc);
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t count = opt.is<size_t>("--count", 1 << 20);
+  size_t accesses = opt.is<size_t>("--accesses", 1 << 22);
+
+  test_random_access(0, count, 64, accesses);
+
+  if constexpr (pal_supports<HugePages, Pal>)
+    test_random_access(NUM_LARGE_CLASSES, count, 64, accesses);
+  else
+    std::cout << "Huge pages not supported on this platform." << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include <snmalloc.h>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <test/xoroshiro.h>
+#include <vector>
+
+using namespace snmalloc;
+
+static constexpr size_t MiB = 1 << 20;
+
+struct Block
+{
+  void* p;
+  size_t size;
+};
+
+/**
+ * Replace random live blocks with `ops` new blocks of between `lo` and
+ * `2 * lo` superslabs, keeping at most `budget` superslabs live.
+ */
+void churn(
+  std::vector<Block>& live,
+  size_t& live_size,
+  xoroshiro::p128r64& r,
+  size_t lo,
+  size_t budget,
+  size_t ops)
+{
+  auto* a = ThreadAlloc::get();
+  for (size_t i = 0; i < ops; i++)
+  {
+    size_t size = (lo * SUPERSLAB_SIZE) + (r.next() % (lo * SUPERSLAB_SIZE));
+    while (live_size + size > budget * SUPERSLAB_SIZE)
+    {
+      size_t victim = r.next() % live.size();
+      a->dealloc(live[victim].p, live[victim].size);
+      live_size -= live[victim].size;
+      live[victim] = live.back();
+      live.pop_back();
+    }
+
+    void* p = a->alloc(size);
+    *static_cast<char*>(p) = 1;
+    live.push_back({p, size});
+    live_size += size;
+  }
+}
+
+/**
+ * Run phases of large allocations whose sizes shift up and down between
+ * phases, with a bounded amount live, and report how much address space is
+ * reserved.  Freed chunks must be split and merged to serve the next phase,
+ * rather than being left behind in the classes of the previous one.
+ */
+void test_shifting_sizes(size_t budget, size_t ops)
+{
+  auto& mp = default_memory_provider();
+  xoroshiro::p128r64 r;
+  std::vector<Block> live;
+  size_t live_size = 0;
+
+  size_t before = mp.reserved();
+  for (size_t lo : {1, 4, 16, 2, 8, 1, 32, 1, 4})
+  {
+    if (lo * 2 > budget)
+      continue;
+
+    DO_TIME("Sizes " << lo << "-" << (lo * 2) << " superslabs", {
+      churn(live, live_size, r, lo, budget, ops);
+    });
+    std::cout << "  live MiB " << (live_size / MiB) << ", reserved MiB "
+              << ((mp.reserved() - before) / MiB) << std::endl;
+  }
+
+  auto* a = ThreadAlloc::get();
+  for (auto& b : live)
+    a->dealloc(b.p, b.size);
+
+  size_t growth = mp.reserved() - before;
+  std::cout << "Reserved " << (growth / SUPERSLAB_SIZE) << " superslabs for "
+            << budget << " live" << std::endl;
+
+  if constexpr (pal_supports<MergeableReservations, GlobalVirtual>)
+  {
+    // Merged chunks can serve every phase, so the growth is bounded by the
+    // fragmentation of a buddy allocator and by reserving several chunks of
+    // the largest class at once, rather than by the sizes seen so far.
+    if (growth > budget * SUPERSLAB_SIZE * 16)
+    {
+      std::cout << "Address space grew too much" << std::endl;
+      abort();
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t budget = opt.is<size_t>("--budget", 128);
+  size_t ops = opt.is<size_t>("--ops", 500);
+
+  test_shifting_sizes(budget, ops);
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+#include <snmalloc.h>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <test/xoroshiro.h>
+#include <vector>
+
+using namespace snmalloc;
+
+struct Node
+{
+  Node* next;
+};
+
+void shuffle(std::vector<void*>& ptrs, xoroshiro::p128r64& r)
+{
+  for (size_t i = ptrs.size(); i > 1; i--)
+    std::swap(ptrs[i - 1], ptrs[r.next() % i]);
+}
+
+/**
+ * Churn `count` objects of `size` bytes, by repeatedly freeing them in a
+ * random order and allocating them again, so that the slabs' free objects
+ * are thoroughly mixed up.  Then allocate a fresh batch, link it into a list
+ * in allocation order, as when building a structure, and report how long it
+ * takes to walk the list and how much of it is in address order.
+ */
+void test_locality(size_t size, size_t count, size_t churn, size_t rounds)
+{
+  auto* a = ThreadAlloc::get();
+  xoroshiro::p128r64 r;
+  std::vector<void*> ptrs(count);
+
+  for (auto& p : ptrs)
+    p = a->alloc(size);
+
+  for (size_t c = 0; c < churn; c++)
+  {
+    shuffle(ptrs, r);
+    for (size_t i = 0; i < count / 2; i++)
+      a->dealloc(ptrs[i], size);
+    for (size_t i = 0; i < count / 2; i++)
+      ptrs[i] = a->alloc(size);
+  }
+
+  // Free a random half and allocate a fresh batch in its place, leaving
+  // the other half live so that the slabs are not simply emptied.
+  size_t batch = count / 2;
+  shuffle(ptrs, r);
+  for (size_t i = 0; i < batch; i++)
+    a->dealloc(ptrs[i], size);
+
+  size_t ascending = 0;
+  for (size_t i = 0; i < batch; i++)
+  {
+    ptrs[i] = a->alloc(size);
+    if ((i > 0) && (ptrs[i - 1] < ptrs[i]))
+      ascending++;
+  }
+
+  for (size_t i = 0; i < batch; i++)
+    static_cast<Node*>(ptrs[i])->next =
+      static_cast<Node*>(i + 1 < batch ? ptrs[i + 1] : nullptr);
+
+  size_t visited = 0;
+  DO_TIME(
+    "Walk " << batch << " fresh " << size << " byte objects, "
+            << (ascending * 100 / (batch - 1)) << "% in address order",
+    {
+      for (size_t n = 0; n < rounds; n++)
+      {
+        for (Node* p = static_cast<Node*>(ptrs[0]); p != nullptr; p = p->next)
+          visited++;
+      }
+    });
+
+  if (visited != batch * rounds)
+    abort();
+
+  for (auto p : ptrs)
+    a->dealloc(p, size);
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t count = opt.is<size_t>("--count", 1 << 18);
+  size_t churn = opt.is<size_t>("--churn", 4);
+  size_t rounds = opt.is<size_t>("--rounds", 10);
+
+  std::cout << "Slab bitmap is " << (SLAB_BITMAP ? "on" : "off") << std::endl;
+
+  for (size_t size : {16, 64, 256})
+    test_locality(size, count, churn, rounds);
+
+  return 0;
+}
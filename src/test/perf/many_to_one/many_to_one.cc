@@ -0,0 +1,95 @@
+#include <iostream>
+#include <snmalloc.h>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <thread>
+#include <vector>
+
+using namespace snmalloc;
+
+/**
+ * An owner thread allocates `count` objects for each of `threads` producer
+ * threads, and the producers free them all at once while the owner handles
+ * its messages, as when many threads hand their work back to one thread
+ * that aggregates it.  With `lanes`, the owner's extra message queues are
+ * added up front, rather than waiting for the contention to be noticed.
+ */
+void test_many_to_one(size_t threads, size_t count, size_t rounds, bool lanes)
+{
+  auto* pool = current_alloc_pool();
+  auto* owner = pool->acquire();
+  void* probe = owner->alloc(16);
+  RemoteAllocator* target = Superslab::get(probe)->get_allocator();
+  owner->dealloc(probe, 16);
+
+  if (lanes)
+  {
+    for (size_t i = 0; i < REMOTE_LANE_CONTENTION; i++)
+      target->record_contention();
+  }
+
+  std::vector<std::vector<void*>> objects(threads);
+  std::atomic<size_t> started = 0;
+  std::atomic<size_t> finished = 0;
+
+  DO_TIME(
+    threads << " threads freeing " << count << " objects each to one owner, "
+            << rounds << " rounds, "
+            << (lanes ? "with lanes" : "single queue"),
+    {
+      for (size_t r = 0; r < rounds; r++)
+      {
+        for (auto& o : objects)
+        {
+          o.resize(count);
+          for (auto& p : o)
+            p = owner->alloc(48);
+        }
+
+        std::vector<std::thread> t;
+        for (size_t i = 0; i < threads; i++)
+        {
+          t.emplace_back([&, i]() {
+            auto* a = ThreadAlloc::get();
+            started++;
+            while (started < threads)
+              std::this_thread::yield();
+
+            for (auto p : objects[i])
+              a->dealloc(p);
+            a->flush_remote_cache();
+            finished++;
+          });
+        }
+
+        while (finished < threads * (r + 1))
+          owner->drain_messages();
+        for (auto& thread : t)
+          thread.join();
+        while (owner->drain_messages() != 0)
+        {
+        }
+        started = 0;
+      }
+    });
+
+  std::cout << "Lanes " << (target->lanes.load() != nullptr ? "on" : "off")
+            << std::endl;
+  pool->release(owner);
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t threads = opt.is<size_t>("--threads", 16);
+  size_t count = opt.is<size_t>("--count", 1 << 14);
+  size_t rounds = opt.is<size_t>("--rounds", 8);
+
+  test_many_to_one(threads, count, rounds, false);
+  test_many_to_one(threads, count, rounds, true);
+
+  return 0;
+}
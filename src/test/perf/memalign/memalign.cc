@@ -0,0 +1,115 @@
+#include <iostream>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <test/xoroshiro.h>
+#include <vector>
+
+#define SNMALLOC_NAME_MANGLE(a) our_##a
+#include "../../../override/malloc.cc"
+
+using namespace snmalloc;
+
+struct Request
+{
+  size_t size;
+  size_t alignment;
+};
+
+/**
+ * Buffer pools as a packet processing framework would set them up: cache
+ * line aligned packet buffers, page aligned rings, and hugepage aligned
+ * memory zones, alongside allocations of similar sizes with only malloc's
+ * alignment.
+ */
+std::vector<Request> dpdk_mix(xoroshiro::p128r64& r, size_t count)
+{
+  static constexpr Request kinds[] = {{2176, 64},
+                                      {2176, 16},
+                                      {65 << 10, 4096},
+                                      {96 << 10, 16384},
+                                      {96 << 10, 16},
+                                      {3 << 20, 2 << 20},
+                                      {3 << 20, 16},
+                                      {5 << 20, 1 << 20},
+                                      {20 << 20, 64 << 20}};
+
+  std::vector<Request> requests;
+  for (size_t i = 0; i < count; i++)
+    requests.push_back(kinds[r.next() % (sizeof(kinds) / sizeof(kinds[0]))]);
+  return requests;
+}
+
+/**
+ * Vector buffers of assorted sizes aligned for SIMD loads.
+ */
+std::vector<Request> simd_mix(xoroshiro::p128r64& r, size_t count)
+{
+  std::vector<Request> requests;
+  for (size_t i = 0; i < count; i++)
+  {
+    size_t size = (r.next() % (256 << 10)) + 1;
+    size_t alignment = size_t(16) << (r.next() % 3);
+    requests.push_back({size, alignment});
+  }
+  return requests;
+}
+
+/**
+ * Allocate every request and free them all, either through posix_memalign
+ * or by allocating `aligned_size(alignment, size)` bytes as posix_memalign
+ * used to.  Reports the bytes used per byte requested.
+ */
+template<bool native>
+void test_mix(const char* name, std::vector<Request>& requests)
+{
+  std::vector<void*> ptrs(requests.size());
+  size_t requested = 0;
+  size_t used = 0;
+
+  DO_TIME(
+    (native ? "native " : "rounded") << " " << name,
+    {
+      for (size_t i = 0; i < requests.size(); i++)
+      {
+        Request& q = requests[i];
+        if constexpr (native)
+        {
+          if (our_posix_memalign(&ptrs[i], q.alignment, q.size) != 0)
+            abort();
+        }
+        else
+          ptrs[i] = our_malloc(aligned_size(q.alignment, q.size));
+
+        if ((address_cast(ptrs[i]) & (q.alignment - 1)) != 0)
+          abort();
+        requested += q.size;
+        used += our_malloc_usable_size(ptrs[i]);
+      }
+
+      for (auto p : ptrs)
+        our_free(p);
+    });
+
+  std::cout << "  overhead: " << (double(used) / double(requested))
+            << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t count = opt.is<size_t>("--count", 1 << 10);
+  xoroshiro::p128r64 r(opt.is<size_t>("--seed", 1));
+
+  auto dpdk = dpdk_mix(r, count / 4);
+  auto simd = simd_mix(r, count);
+
+  test_mix<false>("dpdk", dpdk);
+  test_mix<true>("dpdk", dpdk);
+  test_mix<false>("simd", simd);
+  test_mix<true>("simd", simd);
+
+  return 0;
+}
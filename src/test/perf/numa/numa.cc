@@ -0,0 +1,149 @@
+#define USE_NUMA_NODES 4
+#include <iostream>
+#include <snmalloc.h>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && defined(SYS_getcpu) && defined(SYS_move_pages)
+#  include <sched.h>
+
+using namespace snmalloc;
+
+/**
+ * Find one CPU on each NUMA node, by pinning the calling thread to each CPU
+ * in turn and asking the PAL which node it is on.
+ */
+std::vector<int> cpu_per_node()
+{
+  std::vector<int> result;
+  cpu_set_t original;
+  sched_getaffinity(0, sizeof(original), &original);
+
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+  {
+    if (!CPU_ISSET(cpu, &original))
+      continue;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+      continue;
+
+    size_t node = Pal::get_numa_node();
+    if (node >= result.size())
+      result.resize(node + 1, -1);
+    if (result[node] == -1)
+      result[node] = cpu;
+  }
+
+  sched_setaffinity(0, sizeof(original), &original);
+  return result;
+}
+
+/**
+ * Count the pages in the range that are not on `node`.
+ */
+size_t remote_pages(void* p, size_t size, size_t node, size_t& total)
+{
+  size_t count = size / OS_PAGE_SIZE;
+  std::vector<void*> pages(count);
+  std::vector<int> status(count);
+  for (size_t i = 0; i < count; i++)
+    pages[i] = pointer_offset(p, i * OS_PAGE_SIZE);
+
+  // With no target nodes, move_pages reports where each page currently is.
+  long ok = syscall(
+    SYS_move_pages, 0, count, pages.data(), nullptr, status.data(), 0);
+  if (ok != 0)
+    return 0;
+
+  size_t remote = 0;
+  for (auto s : status)
+  {
+    if ((s >= 0) && (static_cast<size_t>(s) != node))
+      remote++;
+  }
+  total += count;
+  return remote;
+}
+
+/**
+ * Allocate, touch and free `count` objects of `size` bytes twice on a thread
+ * pinned to `cpu`.  The second round is served from memory recycled by the
+ * first, so it shows whether recycled chunks stay on the thread's node.
+ */
+void run_on_node(size_t node, int cpu, size_t count, size_t size)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  sched_setaffinity(0, sizeof(set), &set);
+
+  auto* a = ThreadAlloc::get();
+  std::vector<void*> objects(count);
+
+  for (size_t round = 0; round < 2; round++)
+  {
+    size_t remote = 0;
+    size_t total = 0;
+
+    DO_TIME(
+      "Node " << node << " (cpu " << cpu << "), round " << round, {
+        for (auto& p : objects)
+        {
+          p = a->alloc(size);
+          memset(p, 1, size);
+        }
+      });
+
+    for (auto p : objects)
+      remote += remote_pages(p, size, node, total);
+
+    std::cout << "Node " << node << ", round " << round << ": " << remote
+              << " of " << total << " pages on a remote node" << std::endl;
+
+    for (auto p : objects)
+      a->dealloc(p, size);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t count = opt.is<size_t>("--count", 64);
+  size_t size = opt.is<size_t>("--size", SUPERSLAB_SIZE / 16);
+
+  auto cpus = cpu_per_node();
+  size_t nodes = 0;
+  for (auto cpu : cpus)
+    nodes += (cpu != -1) ? 1 : 0;
+
+  if (nodes < 2)
+    std::cout << "Single NUMA node, all placement is local." << std::endl;
+
+  std::vector<std::thread> threads;
+  for (size_t node = 0; node < cpus.size(); node++)
+  {
+    if (cpus[node] != -1)
+      threads.emplace_back(run_on_node, node, cpus[node], count, size);
+  }
+
+  for (auto& t : threads)
+    t.join();
+
+  return 0;
+}
+#else
+int main()
+{
+  std::cout << "NUMA placement test not supported on this platform."
+            << std::endl;
+  return 0;
+}
+#endif
@@ -0,0 +1,60 @@
+#include <snmalloc.h>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <vector>
+
+using namespace snmalloc;
+
+/**
+ * A pipeline stage: the producer allocates `count` objects of `size` bytes,
+ * the consumer frees them all, and then the producer handles the frees.  The
+ * two allocators take turns on one thread, so this measures the work done
+ * per object rather than the contention between threads.
+ */
+void test_pipeline(size_t size, size_t count, size_t rounds)
+{
+  auto* pool = current_alloc_pool();
+  auto* producer = pool->acquire();
+  auto* consumer = pool->acquire();
+  std::vector<void*> objects(count);
+
+  DO_TIME(
+    "Pipeline of " << count << " " << size << " byte objects, " << rounds
+                   << " rounds",
+    {
+      for (size_t r = 0; r < rounds; r++)
+      {
+        for (auto& p : objects)
+        {
+          p = producer->alloc(size);
+          *static_cast<size_t*>(p) = r;
+        }
+
+        for (auto p : objects)
+          consumer->dealloc(p);
+
+        consumer->flush_remote_cache();
+        while (producer->drain_messages() != 0)
+        {
+        }
+      }
+    });
+
+  pool->release(producer);
+  pool->release(consumer);
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t count = opt.is<size_t>("--count", 1 << 16);
+  size_t rounds = opt.is<size_t>("--rounds", 32);
+
+  for (size_t size : {16, 64, 256, 1024})
+    test_pipeline(size, count, rounds);
+
+  return 0;
+}
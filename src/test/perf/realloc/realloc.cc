@@ -0,0 +1,100 @@
+#include <iostream>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+
+#define SNMALLOC_NAME_MANGLE(a) our_##a
+#include "../../../override/malloc.cc"
+
+using namespace snmalloc;
+
+/**
+ * Write a byte to each page of `p` in `[from, to)`, as a growing buffer
+ * would fill its new space.
+ */
+void touch(void* p, size_t from, size_t to)
+{
+  for (size_t i = bits::align_up(from, OS_PAGE_SIZE); i < to; i += OS_PAGE_SIZE)
+    static_cast<uint8_t*>(p)[i] = static_cast<uint8_t>(i >> 12);
+}
+
+void check(void* p, size_t size)
+{
+  for (size_t i = 0; i < size; i += OS_PAGE_SIZE)
+  {
+    if (static_cast<uint8_t*>(p)[i] != static_cast<uint8_t>(i >> 12))
+    {
+      std::cout << "Contents lost at " << i << " of " << size << std::endl;
+      abort();
+    }
+  }
+}
+
+/**
+ * Grow a buffer by half again each step up to `max` bytes, then shrink it
+ * back down, either with realloc or by allocating, copying and freeing.
+ */
+template<bool use_realloc>
+void test_grow(size_t rounds, size_t max)
+{
+  DO_TIME(
+    (use_realloc ? "realloc     " : "malloc+copy ") << " Max: " << max,
+    {
+      for (size_t r = 0; r < rounds; r++)
+      {
+        size_t size = OS_PAGE_SIZE;
+        void* p = our_malloc(size);
+        touch(p, 0, size);
+
+        while (size < max)
+        {
+          size_t next = bits::min(size + (size >> 1), max);
+          if constexpr (use_realloc)
+            p = our_realloc(p, next);
+          else
+          {
+            void* q = our_malloc(next);
+            memcpy(q, p, size);
+            our_free(p);
+            p = q;
+          }
+          if (p == nullptr)
+            abort();
+          touch(p, size, next);
+          size = next;
+        }
+        check(p, size);
+
+        while (size > OS_PAGE_SIZE)
+        {
+          size_t next = bits::max<size_t>(size >> 2, OS_PAGE_SIZE);
+          if constexpr (use_realloc)
+            p = our_realloc(p, next);
+          else
+          {
+            void* q = our_malloc(next);
+            memcpy(q, p, next);
+            our_free(p);
+            p = q;
+          }
+          size = next;
+        }
+        check(p, size);
+        our_free(p);
+      }
+    });
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t rounds = opt.is<size_t>("--rounds", 8);
+  size_t max = opt.is<size_t>("--max", bits::is64() ? 256 << 20 : 32 << 20);
+
+  test_grow<false>(rounds, max);
+  test_grow<true>(rounds, max);
+
+  return 0;
+}
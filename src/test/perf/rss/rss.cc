@@ -0,0 +1,295 @@
+#include <snmalloc.h>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <test/usage.h>
+#include <test/xoroshiro.h>
+#include <unordered_set>
+#include <vector>
+
+using namespace snmalloc;
+
+static constexpr size_t MiB = 1 << 20;
+
+/**
+ * Allocate and touch `count` large objects, free them all at once and then
+ * purge the unused chunks, reporting the resident set after each step.  On
+ * platforms that release pages lazily, the purge must return almost all of
+ * the memory that was touched.
+ */
+void test_free_burst(size_t count, size_t size)
+{
+  auto* a = ThreadAlloc::get();
+  std::vector<void*> ptrs(count);
+
+  size_t before = usage::resident_bytes();
+  for (auto& p : ptrs)
+  {
+    p = a->alloc(size);
+    memset(p, 1, size);
+  }
+  size_t peak = usage::resident_bytes();
+
+  DO_TIME("Free burst " << count << " x " << (size / MiB) << " MiB", {
+    for (auto p : ptrs)
+      a->dealloc(p);
+  });
+  size_t freed = usage::resident_bytes();
+
+  DO_TIME("Purge", {
+    a->flush_large_cache();
+    default_memory_provider().decommit_all();
+  });
+  size_t purged = usage::resident_bytes();
+
+  std::cout << "Resident MiB: before " << (before / MiB) << ", peak "
+            << (peak / MiB) << ", freed " << (freed / MiB) << ", purged "
+            << (purged / MiB) << std::endl;
+
+  if constexpr (pal_supports<LazyRelease, GlobalVirtual>)
+  {
+    size_t touched = count * size;
+    if ((purged != 0) && (purged > before + (touched / 10)))
+    {
+      std::cout << "Purge did not release the freed memory" << std::endl;
+      abort();
+    }
+  }
+}
+
+/**
+ * Fill `count` superslabs with small objects, then free all but one object
+ * in each of them.  The survivors keep every superslab in use, so only the
+ * slab level decommit can return the rest of the memory.
+ */
+void test_stragglers(size_t count, size_t size)
+{
+  auto* a = ThreadAlloc::get();
+  std::vector<void*> ptrs((count * SUPERSLAB_SIZE) / size);
+  std::vector<void*> survivors;
+
+  size_t before = usage::resident_bytes();
+  for (auto& p : ptrs)
+  {
+    p = a->alloc(size);
+    memset(p, 1, size);
+  }
+  size_t peak = usage::resident_bytes();
+
+  DO_TIME("Free all but one " << size << " byte object per superslab", {
+    Superslab* last = nullptr;
+    for (auto p : ptrs)
+    {
+      if (Superslab::get(p) != last)
+      {
+        last = Superslab::get(p);
+        survivors.push_back(p);
+        continue;
+      }
+      a->dealloc(p, size);
+    }
+  });
+  size_t freed = usage::resident_bytes();
+
+  std::cout << "Resident MiB: before " << (before / MiB) << ", peak "
+            << (peak / MiB) << ", freed " << (freed / MiB) << " with "
+            << survivors.size() << " superslabs in use" << std::endl;
+
+  for (auto p : survivors)
+    a->dealloc(p, size);
+
+  if constexpr (
+    pal_supports<LazyRelease, GlobalVirtual> &&
+    (decommit_strategy == DecommitSuper))
+  {
+    size_t touched = ptrs.size() * size;
+    if ((freed != 0) && (freed > before + (touched / 10)))
+    {
+      std::cout << "Empty slabs were not decommitted" << std::endl;
+      abort();
+    }
+  }
+}
+
+/**
+ * Allocate `count` medium slabs worth of buffers and touch them, then free
+ * all but one buffer in each slab.  The free buffers should stop being
+ * resident even though every slab is still in use.
+ */
+void test_medium_buffers(size_t count, size_t size)
+{
+  auto* a = ThreadAlloc::get();
+  size_t per_slab = SUPERSLAB_SIZE / size;
+  std::vector<void*> ptrs(count * per_slab);
+
+  size_t before = usage::resident_bytes();
+  for (auto& p : ptrs)
+  {
+    p = a->alloc(size);
+    memset(p, 1, size);
+  }
+  size_t peak = usage::resident_bytes();
+
+  DO_TIME("Free all but one " << (size / 1024) << " KiB buffer per slab", {
+    for (size_t i = 0; i < ptrs.size(); i++)
+    {
+      if ((i % per_slab) != 0)
+        a->dealloc(ptrs[i], size);
+    }
+  });
+  size_t freed = usage::resident_bytes();
+
+  std::cout << "Resident MiB: before " << (before / MiB) << ", peak "
+            << (peak / MiB) << ", freed " << (freed / MiB) << std::endl;
+
+  for (size_t i = 0; i < ptrs.size(); i += per_slab)
+    a->dealloc(ptrs[i], size);
+
+  if constexpr (
+    pal_supports<LazyRelease, GlobalVirtual> &&
+    (decommit_strategy == DecommitSuper) && (MEDIUM_DECOMMIT_SIZE != 0))
+  {
+    size_t touched = ptrs.size() * size;
+    if (
+      (size >= MEDIUM_DECOMMIT_SIZE) && (freed != 0) &&
+      (freed > before + (touched / 4)))
+    {
+      std::cout << "Free medium objects were not decommitted" << std::endl;
+      abort();
+    }
+  }
+}
+
+/**
+ * Allocate and touch `count` large blocks of between 1.25 and 2.5
+ * superslabs, and report the address space that they hold, the address
+ * space reserved and the resident set against the bytes requested.
+ */
+void test_large_blocks(size_t count)
+{
+  auto* a = ThreadAlloc::get();
+  auto& mp = default_memory_provider();
+  xoroshiro::p128r64 r;
+  std::vector<void*> ptrs(count);
+
+  size_t reserved = mp.reserved();
+  size_t before = usage::resident_bytes();
+  size_t requested = 0;
+  size_t held = 0;
+  for (auto& p : ptrs)
+  {
+    size_t size = (SUPERSLAB_SIZE * 5 / 4) +
+      (r.next() % (SUPERSLAB_SIZE * 5 / 4));
+    requested += size;
+    p = a->alloc(size);
+    held += Alloc::alloc_size(p);
+    memset(p, 1, size);
+  }
+
+  std::cout << "Large blocks MiB: requested " << (requested / MiB)
+            << ", held " << (held / MiB) << ", reserved "
+            << ((mp.reserved() - reserved) / MiB)
+            << ", resident " << ((usage::resident_bytes() - before) / MiB)
+            << std::endl;
+
+  for (auto p : ptrs)
+    a->dealloc(p);
+}
+
+/**
+ * Count the slabs and superslabs that hold the live small objects `ptrs`.
+ */
+void count_held(std::vector<void*>& ptrs, size_t& slabs, size_t& supers)
+{
+  std::unordered_set<void*> slab_set;
+  std::unordered_set<void*> super_set;
+  for (auto p : ptrs)
+  {
+    slab_set.insert(Metaslab::get_slab(p));
+    super_set.insert(Superslab::get(p));
+  }
+  slabs = slab_set.size();
+  supers = super_set.size();
+}
+
+/**
+ * Fill `count` superslabs with small objects of mixed sizes, then churn
+ * them while the live set slowly shrinks to an eighth: each round frees a
+ * random quarter of the live objects and allocates back most of them.
+ * Reports the slabs and superslabs that still hold live objects as the
+ * live set shrinks, which is the memory that cannot be returned.
+ */
+void test_shrinking_churn(size_t count)
+{
+  auto* a = ThreadAlloc::get();
+  xoroshiro::p128r64 r;
+  std::vector<void*> ptrs;
+  std::vector<size_t> sizes;
+  size_t live = 0;
+
+  while (live < count * SUPERSLAB_SIZE)
+  {
+    size_t size = 16 << (r.next() % 5);
+    ptrs.push_back(a->alloc(size));
+    sizes.push_back(size);
+    live += size;
+  }
+
+  size_t start = live;
+  size_t slabs;
+  size_t supers;
+  DO_TIME("Shrinking churn over " << count << " superslabs", {
+    for (size_t round = 0; live > start / 8; round++)
+    {
+      for (size_t n = ptrs.size() / 4; n > 0; n--)
+      {
+        size_t i = r.next() % ptrs.size();
+        a->dealloc(ptrs[i], sizes[i]);
+        live -= sizes[i];
+        ptrs[i] = ptrs.back();
+        sizes[i] = sizes.back();
+        ptrs.pop_back();
+        sizes.pop_back();
+      }
+
+      for (size_t n = ptrs.size() / 4; n > 0; n--)
+      {
+        size_t size = 16 << (r.next() % 5);
+        ptrs.push_back(a->alloc(size));
+        sizes.push_back(size);
+        live += size;
+      }
+
+      if ((round % 4) == 0)
+      {
+        count_held(ptrs, slabs, supers);
+        std::cout << "  live KiB " << (live / 1024) << " in " << slabs
+                  << " slabs and " << supers << " superslabs" << std::endl;
+      }
+    }
+  });
+
+  count_held(ptrs, slabs, supers);
+  std::cout << "Live KiB " << (live / 1024) << " held in " << slabs
+            << " slabs (" << ((live * 100) / (slabs * SLAB_SIZE))
+            << "% full) and " << supers << " superslabs" << std::endl;
+
+  for (size_t i = 0; i < ptrs.size(); i++)
+    a->dealloc(ptrs[i], sizes[i]);
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t count = opt.is<size_t>("--count", 8);
+
+  test_free_burst(count, SUPERSLAB_SIZE + (SUPERSLAB_SIZE / 2));
+  test_stragglers(count, 256);
+  test_medium_buffers(count, SUPERSLAB_SIZE / 8);
+  test_large_blocks(count * 4);
+  test_shrinking_churn(count);
+
+  return 0;
+}
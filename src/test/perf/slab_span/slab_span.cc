@@ -0,0 +1,98 @@
+#include <snmalloc.h>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <test/usage.h>
+#include <thread>
+#include <vector>
+
+using namespace snmalloc;
+
+static constexpr size_t KiB = 1024;
+
+/**
+ * Start `count` threads that each allocate one object of each of a few
+ * small and medium sizes and then sit idle, and report the resident set and
+ * the address space reserved per thread while they are idle.
+ */
+void test_idle_threads(size_t count)
+{
+  auto& mp = default_memory_provider();
+  std::atomic<size_t> ready = 0;
+  std::atomic<bool> done = false;
+
+  size_t reserved = mp.reserved();
+  size_t resident = usage::resident_bytes();
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < count; i++)
+  {
+    threads.emplace_back([&]() {
+      auto* a = ThreadAlloc::get();
+      std::vector<void*> ptrs;
+      for (size_t size : {16, 256, 4096, 20 * 1024, 48 * 1024})
+      {
+        ptrs.push_back(a->alloc(size));
+        memset(ptrs.back(), 1, size);
+      }
+
+      ready++;
+      while (!done)
+        std::this_thread::yield();
+
+      for (auto p : ptrs)
+        a->dealloc(p);
+    });
+  }
+
+  while (ready != count)
+    std::this_thread::yield();
+
+  std::cout << "Idle threads: " << count << ", resident KiB per thread "
+            << ((usage::resident_bytes() - resident) / KiB / count)
+            << ", reserved KiB per thread "
+            << ((mp.reserved() - reserved) / KiB / count) << std::endl;
+
+  done = true;
+  for (auto& t : threads)
+    t.join();
+}
+
+/**
+ * Repeatedly allocate `live` objects of `size` bytes and free them, so that
+ * every round has to find fresh space for them, and report the time taken.
+ */
+void test_refill(size_t size, size_t live, size_t rounds)
+{
+  auto* a = ThreadAlloc::get();
+  std::vector<void*> ptrs(live);
+
+  DO_TIME("Refill " << (size / KiB) << " KiB objects, " << live << " live", {
+    for (size_t r = 0; r < rounds; r++)
+    {
+      for (auto& p : ptrs)
+      {
+        p = a->alloc(size);
+        *static_cast<char*>(p) = 1;
+      }
+      for (auto p : ptrs)
+        a->dealloc(p, size);
+    }
+  });
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t threads = opt.is<size_t>("--threads", 16);
+  size_t rounds = opt.is<size_t>("--rounds", 100);
+
+  test_idle_threads(threads);
+
+  for (size_t size = 16 * KiB; size <= 64 * KiB; size += 8 * KiB)
+    test_refill(size, 64, rounds);
+
+  return 0;
+}
@@ -0,0 +1,93 @@
+#include <ds/eliminationstack.h>
+#include <ds/mpmcstack.h>
+#include <iostream>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <thread>
+
+using namespace snmalloc;
+
+struct Node
+{
+  std::atomic<Node*> next{nullptr};
+};
+
+/**
+ * Each of `threads` threads repeatedly pops a node from a shared stack and
+ * pushes it back, `count` times, as allocators do with the pool and with the
+ * large stacks.  Reports the ticks per operation, and checks that no
+ * node was lost or duplicated.
+ */
+template<class Stack>
+void test_push_pop(const char* name, size_t threads, size_t count)
+{
+  auto* stack = new Stack();
+  size_t nodes = threads * 2;
+  auto* node = new Node[nodes];
+  for (size_t i = 0; i < nodes; i++)
+    stack->push(&node[i]);
+
+  std::atomic<size_t> ready = 0;
+  std::atomic<bool> flag = false;
+  auto run = [&]() {
+    ready++;
+    while (!flag)
+      Aal::pause();
+
+    for (size_t n = 0; n < count; n++)
+    {
+      Node* p = stack->pop();
+      if (p != nullptr)
+        stack->push(p);
+    }
+  };
+
+  std::thread* t = new std::thread[threads];
+  for (size_t i = 0; i < threads; i++)
+    t[i] = std::thread(run);
+  while (ready != threads)
+    Aal::pause();
+
+  uint64_t start = Aal::tick();
+  flag = true;
+  for (size_t i = 0; i < threads; i++)
+    t[i].join();
+  uint64_t time = Aal::tick() - start;
+  delete[] t;
+
+  size_t found = 0;
+  for (Node* p = stack->pop_all(); p != nullptr; p = p->next)
+    found++;
+
+  if (found != nodes)
+  {
+    std::cout << name << " lost nodes: " << found << " of " << nodes
+              << std::endl;
+    abort();
+  }
+
+  size_t ops = threads * count * 2;
+  std::cout << name << ", " << threads << " threads, " << ops
+            << " operations " << time << " ticks, " << (time / ops)
+            << " ticks per operation" << std::endl;
+
+  delete[] node;
+  delete stack;
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t cores = opt.is<size_t>("--cores", 8);
+  size_t count = opt.is<size_t>("--count", 1 << 18);
+
+  for (size_t i = 1; i <= cores; i <<= 1)
+  {
+    test_push_pop<MPMCStack<Node>>("Treiber stack", i, count);
+    test_push_pop<EliminationStack<Node>>("Elimination stack", i, count);
+  }
+
+  return 0;
+}
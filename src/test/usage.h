@@ -10,6 +10,11 @@
 #  include <psapi.h>
 #endif
 
+#if defined(__linux__)
+#  include <stdio.h>
+#  include <unistd.h>
+#endif
+
 #include <iomanip>
 #include <iostream>
 
@@ -39,6 +44,35 @@ namespace usage
               << "\tPagefileUsage: " << pmc.PagefileUsage << std::endl
               << "\tPeakPagefileUsage: " << pmc.PeakPagefileUsage << std::endl
               << "\tPrivateUsage: " << pmc.PrivateUsage << std::endl;
+#endif
+  }
+
+  /**
+   * Bytes of memory currently resident for this process, or zero if this
+   * is not known on this platform.
+   */
+  size_t resident_bytes()
+  {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+      return 0;
+    return pmc.WorkingSetSize;
+#elif defined(__linux__)
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f == nullptr)
+      return 0;
+
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    int fields = fscanf(f, "%lu %lu", &size, &resident);
+    fclose(f);
+    if (fields != 2)
+      return 0;
+    return static_cast<size_t>(resident) *
+      static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
 #endif
   }
 };